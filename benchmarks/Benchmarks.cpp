@@ -0,0 +1,554 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <sqlpp11/postgresql/connection.h>
+#include <sqlpp11/sqlpp11.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include "sqlpp_bench.h"
+
+// Runs against the server given by the usual libpq environment variables
+// (PGHOST, PGPORT, PGDATABASE, PGUSER, PGPASSWORD). The database should be a
+// disposable one: the sqlpp_bench table is dropped and recreated.
+
+namespace sql = sqlpp::postgresql;
+
+namespace
+{
+  // Counts every global operator new, so that benchmarks can report allocations per iteration
+  std::atomic<size_t> allocations{0};
+}
+
+void* operator new(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+namespace
+{
+  const bench::sqlpp_bench tab{};
+
+  constexpr int64_t large_result_rows = 100000;
+
+  std::shared_ptr<sql::connection_config> make_config(bool binary = false)
+  {
+    auto config = std::make_shared<sql::connection_config>();
+    config->binary_results = binary;
+    config->binary_parameters = binary;
+    return config;
+  }
+
+  std::string read_file(const std::string& path)
+  {
+    std::ifstream in(path);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+
+  void setup_table()
+  {
+    sql::connection db(make_config());
+    db.execute("DROP TABLE IF EXISTS sqlpp_bench");
+    db.execute(read_file(SQLPP_BENCH_DDL));
+    db.execute("INSERT INTO sqlpp_bench (id, ival, fval, bval, tval) SELECT i, i * 7, i / 3.0, i % 2 = 0, "
+               "md5(i::text) FROM generate_series(1, " +
+               std::to_string(large_result_rows) + ") AS i");
+    db.execute("ANALYZE sqlpp_bench");
+  }
+
+  // The ostringstream based context used before the buffered one, as a baseline
+  struct ostream_context_t
+  {
+    ostream_context_t(const sql::connection& db) : _db(db)
+    {
+    }
+
+    template <typename T>
+    std::ostream& operator<<(T t)
+    {
+      return _os << t;
+    }
+
+    std::ostream& operator<<(bool t)
+    {
+      return _os << (t ? "TRUE" : "FALSE");
+    }
+
+    std::string escape(const std::string& arg)
+    {
+      return _db.escape(arg);
+    }
+
+    std::string str() const
+    {
+      return _os.str();
+    }
+
+    size_t count() const
+    {
+      return _count;
+    }
+
+    void pop_count()
+    {
+      ++_count;
+    }
+
+    const sql::connection& _db;
+    std::ostringstream _os;
+    size_t _count{1};
+  };
+}
+
+// Serialization
+
+static void BM_SerializeOstream(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  for (auto _ : state)
+  {
+    ostream_context_t ctx(db);
+    serialize(select(tab.id, tab.tval).from(tab).where(tab.ival > 5 and tab.tval == "it's"), ctx);
+    benchmark::DoNotOptimize(ctx.str());
+  }
+}
+BENCHMARK(BM_SerializeOstream);
+
+static void BM_SerializeBuffered(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  for (auto _ : state)
+  {
+    sql::context_t ctx(db);
+    serialize(select(tab.id, tab.tval).from(tab).where(tab.ival > 5 and tab.tval == "it's"), ctx);
+    benchmark::DoNotOptimize(ctx.str().data());
+  }
+}
+BENCHMARK(BM_SerializeBuffered);
+
+// Direct vs. prepared execution
+
+static void BM_DirectSelect(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  int64_t id = 0;
+  for (auto _ : state)
+  {
+    for (const auto& row : db(select(tab.ival).from(tab).where(tab.id == (id++ % large_result_rows) + 1)))
+    {
+      benchmark::DoNotOptimize(row.ival.value());
+    }
+  }
+}
+BENCHMARK(BM_DirectSelect);
+
+static void BM_PreparedSelect(benchmark::State& state)
+{
+  sql::connection db(make_config(state.range(0) != 0));
+  auto prepared = db.prepare(select(tab.ival).from(tab).where(tab.id == parameter(tab.id)));
+  int64_t id = 0;
+  for (auto _ : state)
+  {
+    prepared.params.id = (id++ % large_result_rows) + 1;
+    for (const auto& row : db(prepared))
+    {
+      benchmark::DoNotOptimize(row.ival.value());
+    }
+  }
+}
+BENCHMARK(BM_PreparedSelect)->ArgName("binary")->Arg(0)->Arg(1);
+
+static void BM_PrepareCached(benchmark::State& state)
+{
+  auto config = make_config();
+  config->statement_cache_size = static_cast<size_t>(state.range(0));
+  sql::connection db(config);
+  for (auto _ : state)
+  {
+    auto prepared = db.prepare(select(tab.ival).from(tab).where(tab.id == parameter(tab.id)));
+    benchmark::DoNotOptimize(prepared);
+  }
+}
+BENCHMARK(BM_PrepareCached)->ArgName("cache")->Arg(0)->Arg(64);
+
+// Parameter binding, without executing
+
+static void BM_BindParameters(benchmark::State& state)
+{
+  sql::connection db(make_config(state.range(0) != 0));
+  auto prepared = db.prepare(
+      select(tab.id)
+          .from(tab)
+          .where(tab.ival == parameter(tab.ival) and tab.fval == parameter(tab.fval) and
+                 tab.bval == parameter(tab.bval) and tab.tval == parameter(tab.tval)));
+  int64_t i = 0;
+  const auto allocations_before = allocations.load();
+  for (auto _ : state)
+  {
+    prepared.params.ival = ++i;
+    prepared.params.fval = i / 3.0;
+    prepared.params.bval = i % 2 == 0;
+    prepared.params.tval = "parameter text";
+    prepared._prepared_statement._reset();
+    prepared._bind_params();
+  }
+  state.counters["allocations"] = benchmark::Counter(static_cast<double>(allocations.load() - allocations_before),
+                                                     benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * 4);
+}
+BENCHMARK(BM_BindParameters)->ArgName("binary")->Arg(0)->Arg(1);
+
+// Result binding, one column of each type; items are cells
+
+template <typename Column>
+static void bind_column(benchmark::State& state, const Column& column)
+{
+  sql::connection db(make_config(state.range(0) != 0));
+  auto prepared = db.prepare(select(column).from(tab).where(tab.id <= parameter(tab.id)));
+  prepared.params.id = 10000;
+  size_t cells = 0;
+  for (auto _ : state)
+  {
+    for (const auto& row : db(prepared))
+    {
+      benchmark::DoNotOptimize(row);
+      ++cells;
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(cells));
+}
+
+static void BM_BindIntegralResult(benchmark::State& state)
+{
+  bind_column(state, tab.ival);
+}
+BENCHMARK(BM_BindIntegralResult)->ArgName("binary")->Arg(0)->Arg(1);
+
+static void BM_BindFloatingPointResult(benchmark::State& state)
+{
+  bind_column(state, tab.fval);
+}
+BENCHMARK(BM_BindFloatingPointResult)->ArgName("binary")->Arg(0)->Arg(1);
+
+static void BM_BindBooleanResult(benchmark::State& state)
+{
+  bind_column(state, tab.bval);
+}
+BENCHMARK(BM_BindBooleanResult)->ArgName("binary")->Arg(0)->Arg(1);
+
+static void BM_BindTextResult(benchmark::State& state)
+{
+  bind_column(state, tab.tval);
+}
+BENCHMARK(BM_BindTextResult)->ArgName("binary")->Arg(0)->Arg(1);
+
+// Transactions
+
+static void BM_EmptyTransaction(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  for (auto _ : state)
+  {
+    auto tx = start_transaction(db);
+    tx.commit();
+  }
+}
+BENCHMARK(BM_EmptyTransaction);
+
+// Large results; items are rows
+
+static void BM_LargeResultMaterialized(benchmark::State& state)
+{
+  sql::connection db(make_config(state.range(0) != 0));
+  for (auto _ : state)
+  {
+    for (const auto& row : db(select(tab.id, tab.ival, tab.tval).from(tab).where(tab.id > 0)))
+    {
+      benchmark::DoNotOptimize(row);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * large_result_rows);
+}
+BENCHMARK(BM_LargeResultMaterialized)->ArgName("binary")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_LargeResultStreaming(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  for (auto _ : state)
+  {
+    auto result = db.select_streaming(select(tab.id, tab.ival, tab.tval).from(tab).where(tab.id > 0),
+                                      static_cast<size_t>(state.range(0)));
+    while (result.next_row())
+    {
+      benchmark::DoNotOptimize(result.text(2).data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * large_result_rows);
+}
+BENCHMARK(BM_LargeResultStreaming)->ArgName("chunk")->Arg(1)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+static void BM_LargeResultCursor(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  for (auto _ : state)
+  {
+    auto tx = start_transaction(db);
+    {
+      auto result = db.select_cursor(select(tab.id, tab.ival, tab.tval).from(tab).where(tab.id > 0),
+                                     static_cast<size_t>(state.range(0)));
+      while (result.next_row())
+      {
+        benchmark::DoNotOptimize(result.text(2).data());
+      }
+    }
+    tx.commit();
+  }
+  state.SetItemsProcessed(state.iterations() * large_result_rows);
+}
+BENCHMARK(BM_LargeResultCursor)->ArgName("fetch")->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+static void BM_LargeResultColumns(benchmark::State& state)
+{
+  sql::connection db(make_config(state.range(0) != 0));
+  for (auto _ : state)
+  {
+    std::vector<int64_t> ids;
+    std::vector<int64_t> ivals;
+    std::vector<uint8_t> validity;
+    auto result = db.select(select(tab.id, tab.ival).from(tab).where(tab.id > 0));
+    result.fetch_columns({{0, ids}, {1, ivals, &validity}});
+    benchmark::DoNotOptimize(ivals.data());
+  }
+  state.SetItemsProcessed(state.iterations() * large_result_rows);
+}
+BENCHMARK(BM_LargeResultColumns)->ArgName("binary")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_LargeResultTyped(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  for (auto _ : state)
+  {
+    auto result = db.select(select(tab.id, tab.ival).from(tab).where(tab.id > 0));
+    int64_t sum = 0;
+    if (result.next_row())
+    {
+      result.expect_column<bench::sqlpp_bench_::Id>(0);
+      result.expect_column<bench::sqlpp_bench_::Ival>(1);
+      do
+      {
+        sum += result.get<bench::sqlpp_bench_::Id>(0);
+        if (!result.is_null(1))
+        {
+          sum += result.get<bench::sqlpp_bench_::Ival>(1);
+        }
+      } while (result.next_row());
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * large_result_rows);
+}
+BENCHMARK(BM_LargeResultTyped)->Unit(benchmark::kMillisecond);
+
+static void BM_LargeResultColumnsParallel(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  for (auto _ : state)
+  {
+    std::vector<int64_t> ids;
+    std::vector<int64_t> ivals;
+    std::vector<uint8_t> validity;
+    auto result = db.select(select(tab.id, tab.ival).from(tab).where(tab.id > 0));
+    result.fetch_columns_parallel({{0, ids}, {1, ivals, &validity}}, static_cast<size_t>(state.range(0)));
+    benchmark::DoNotOptimize(ivals.data());
+  }
+  state.SetItemsProcessed(state.iterations() * large_result_rows);
+}
+BENCHMARK(BM_LargeResultColumnsParallel)->ArgName("threads")->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond);
+
+// Bulk loading and export; items are rows
+
+static void BM_InsertSingleRows(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  auto prepared = db.prepare(insert_into(tab).set(tab.id = parameter(tab.id), tab.ival = parameter(tab.ival)));
+  int64_t id = large_result_rows;
+  const auto allocations_before = allocations.load();
+  for (auto _ : state)
+  {
+    auto tx = start_transaction(db);
+    for (int i = 0; i < 1000; ++i)
+    {
+      prepared.params.id = ++id;
+      prepared.params.ival = id;
+      db(prepared);
+    }
+    tx.rollback();
+  }
+  state.counters["allocations"] = benchmark::Counter(static_cast<double>(allocations.load() - allocations_before),
+                                                     benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_InsertSingleRows)->Unit(benchmark::kMillisecond);
+
+static void BM_InsertBatch(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  int64_t id = large_result_rows;
+  for (auto _ : state)
+  {
+    auto tx = start_transaction(db);
+    {
+      auto batch = db.batch_insert(static_cast<size_t>(state.range(0)), tab, tab.id, tab.ival);
+      for (int i = 0; i < 1000; ++i)
+      {
+        ++id;
+        batch.add_row(id, id);
+      }
+      batch.flush();
+    }
+    tx.rollback();
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_InsertBatch)->ArgName("rows")->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+static void BM_UpdateUnnest(benchmark::State& state)
+{
+  sql::connection db(make_config(state.range(0) != 0));
+  auto prepared = db.prepare_execute(
+      "UPDATE sqlpp_bench SET ival = u.ival FROM unnest($1::bigint[], $2::bigint[]) AS u(id, ival) "
+      "WHERE sqlpp_bench.id = u.id",
+      2);
+  std::vector<int64_t> ids;
+  for (int64_t id = 1; id <= 1000; ++id)
+  {
+    ids.push_back(id);
+  }
+  for (auto _ : state)
+  {
+    auto tx = start_transaction(db);
+    prepared.bind_array(0, ids);
+    prepared.bind_array(1, ids);
+    db.run_prepared_execute(prepared);
+    tx.rollback();
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_UpdateUnnest)->ArgName("binary")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_InsertPipeline(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  auto prepared = db.prepare(insert_into(tab).set(tab.id = parameter(tab.id), tab.ival = parameter(tab.ival)));
+  int64_t id = large_result_rows;
+  for (auto _ : state)
+  {
+    auto tx = start_transaction(db);
+    {
+      auto pipeline = db.pipeline();
+      for (int i = 0; i < 1000; ++i)
+      {
+        prepared.params.id = ++id;
+        prepared.params.ival = id;
+        pipeline.run_prepared_insert(prepared);
+      }
+      benchmark::DoNotOptimize(pipeline.sync());
+    }
+    tx.rollback();
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_InsertPipeline)->Unit(benchmark::kMillisecond);
+
+static void BM_CopyIn(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  const auto format = state.range(0) != 0 ? sql::copy_format_t::binary : sql::copy_format_t::text;
+  int64_t id = large_result_rows;
+  for (auto _ : state)
+  {
+    auto tx = start_transaction(db);
+    {
+      auto copy = db.copy_into(format, tab, tab.id, tab.ival, tab.tval);
+      for (int i = 0; i < 10000; ++i)
+      {
+        ++id;
+        copy.add_row(id, id, "copied text");
+      }
+      copy.finish();
+    }
+    tx.rollback();
+  }
+  state.SetItemsProcessed(state.iterations() * 10000);
+}
+BENCHMARK(BM_CopyIn)->ArgName("binary")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_CopyOut(benchmark::State& state)
+{
+  sql::connection db(make_config());
+  const auto format = state.range(0) != 0 ? sql::copy_format_t::binary : sql::copy_format_t::text;
+  for (auto _ : state)
+  {
+    auto copy = db.copy_out(format, tab, tab.id, tab.ival, tab.tval);
+    size_t bytes = 0;
+    copy.for_each([&bytes](const char*, size_t length) { bytes += length; });
+    benchmark::DoNotOptimize(bytes);
+  }
+  state.SetItemsProcessed(state.iterations() * large_result_rows);
+}
+BENCHMARK(BM_CopyOut)->ArgName("binary")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+  {
+    return 1;
+  }
+  setup_table();
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,114 @@
+#ifndef BENCH_SQLPP_BENCH_H
+#define BENCH_SQLPP_BENCH_H
+
+#include <sqlpp11/table.h>
+#include <sqlpp11/char_sequence.h>
+#include <sqlpp11/column_types.h>
+#include <sqlpp11/postgresql/column_type.h>
+
+namespace bench {
+
+	namespace sqlpp_bench_ {
+
+		struct Id {
+			struct _alias_t {
+				static constexpr const char _literal[] ="id";
+				using _name_t = sqlpp::make_char_sequence<sizeof(_literal), _literal>;
+				template<typename T>
+					struct _member_t {
+						T id;
+						T &operator()() { return id; }
+						const T &operator()() const { return id; }
+					};
+			};
+
+			using _traits = ::sqlpp::make_traits<::sqlpp::bigint, sqlpp::tag::require_insert>;
+			using _postgresql_type = ::sqlpp::postgresql::column_type_t<20, ::sqlpp::postgresql::wire_format_t::text>;
+		};
+
+		struct Ival {
+			struct _alias_t {
+				static constexpr const char _literal[] ="ival";
+				using _name_t = sqlpp::make_char_sequence<sizeof(_literal), _literal>;
+				template<typename T>
+					struct _member_t {
+						T ival;
+						T &operator()() { return ival; }
+						const T &operator()() const { return ival; }
+					};
+			};
+
+			using _traits = ::sqlpp::make_traits<::sqlpp::bigint, sqlpp::tag::can_be_null>;
+			using _postgresql_type = ::sqlpp::postgresql::column_type_t<20, ::sqlpp::postgresql::wire_format_t::text>;
+		};
+
+		struct Fval {
+			struct _alias_t {
+				static constexpr const char _literal[] ="fval";
+				using _name_t = sqlpp::make_char_sequence<sizeof(_literal), _literal>;
+				template<typename T>
+					struct _member_t {
+						T fval;
+						T &operator()() { return fval; }
+						const T &operator()() const { return fval; }
+					};
+			};
+
+			using _traits = ::sqlpp::make_traits<::sqlpp::floating_point, sqlpp::tag::can_be_null>;
+			using _postgresql_type = ::sqlpp::postgresql::column_type_t<701, ::sqlpp::postgresql::wire_format_t::text>;
+		};
+
+		struct Bval {
+			struct _alias_t {
+				static constexpr const char _literal[] ="bval";
+				using _name_t = sqlpp::make_char_sequence<sizeof(_literal), _literal>;
+				template<typename T>
+					struct _member_t {
+						T bval;
+						T &operator()() { return bval; }
+						const T &operator()() const { return bval; }
+					};
+			};
+
+			using _traits = ::sqlpp::make_traits<::sqlpp::boolean, sqlpp::tag::can_be_null>;
+			using _postgresql_type = ::sqlpp::postgresql::column_type_t<16, ::sqlpp::postgresql::wire_format_t::text>;
+		};
+
+		struct Tval {
+			struct _alias_t {
+				static constexpr const char _literal[] ="tval";
+				using _name_t = sqlpp::make_char_sequence<sizeof(_literal), _literal>;
+				template<typename T>
+					struct _member_t {
+						T tval;
+						T &operator()() { return tval; }
+						const T &operator()() const { return tval; }
+					};
+			};
+
+			using _traits = ::sqlpp::make_traits<::sqlpp::text, sqlpp::tag::can_be_null>;
+			using _postgresql_type = ::sqlpp::postgresql::column_type_t<25, ::sqlpp::postgresql::wire_format_t::text>;
+		};
+	}
+
+	struct sqlpp_bench : sqlpp::table_t<sqlpp_bench,
+				sqlpp_bench_::Id,
+				sqlpp_bench_::Ival,
+				sqlpp_bench_::Fval,
+				sqlpp_bench_::Bval,
+				sqlpp_bench_::Tval> {
+		using _value_type = sqlpp::no_value_t;
+		struct _alias_t {
+			static constexpr const char _literal[] = "sqlpp_bench";
+			using _name_t = sqlpp::make_char_sequence<sizeof(_literal), _literal>;
+			template<typename T>
+				struct _member_t {
+					T sqlpp_bench;
+					T &operator()() { return sqlpp_bench; }
+					const T &operator()() const { return sqlpp_bench; }
+				};
+		};
+	};
+}
+
+#endif
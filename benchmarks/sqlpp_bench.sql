@@ -0,0 +1,8 @@
+-- Table used by the benchmarks, sqlpp_bench.h is generated from it with scripts/ddl2cpp.py -n bench
+CREATE TABLE sqlpp_bench (
+  id bigint NOT NULL PRIMARY KEY,
+  ival bigint,
+  fval double precision,
+  bval boolean,
+  tval text
+);
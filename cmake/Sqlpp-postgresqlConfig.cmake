@@ -27,6 +27,7 @@ include(CMakeFindDependencyMacro)
 
 find_dependency(Sqlpp11 REQUIRED)
 find_dependency(PostgreSQL REQUIRED)
+find_dependency(Threads REQUIRED)
 
 include("${CMAKE_CURRENT_LIST_DIR}/Sqlpp-postgresqlTargets.cmake")
 
@@ -0,0 +1,181 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_BATCH_INSERT_H
+#define SQLPP_POSTGRESQL_BATCH_INSERT_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sqlpp11/postgresql/prepared_statement.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    // Forward declaration
+    class connection;
+
+    // Inserts rows with multi-row INSERT ... VALUES statements, for when COPY
+    // is not an option, e.g. because INSERT triggers and rules have to fire.
+    // Rows are sent as soon as max_rows of them have been added, flush() sends
+    // the remainder in chunks of power-of-two row counts. So only a few
+    // statement shapes exist, each one is prepared once and then reused.
+    class batch_insert_t
+    {
+    private:
+      connection* _db{nullptr};
+      // "INSERT INTO table (columns) VALUES "
+      std::string _prefix;
+      size_t _columns{0};
+      size_t _max_rows{0};
+      // The values of all pending rows, back to back
+      std::string _data;
+      std::vector<size_t> _ends;
+      std::vector<bool> _nulls;
+      size_t _column{0};
+      size_t _inserted{0};
+      // Prepared statements by the number of rows they insert
+      std::map<size_t, prepared_statement_t> _statements;
+
+      //! inserts the first rows, at most _max_rows of them
+      void send(size_t rows);
+      //! removes the first rows, once they have been inserted
+      void drop_rows(size_t rows);
+      //! removes the values of the row being added, which was rejected
+      void discard_row();
+      void begin_field();
+
+      template <typename T>
+      void add_value(const T& value, std::true_type /* integral */)
+      {
+        _write_integral(static_cast<int64_t>(value));
+      }
+
+      template <typename T>
+      void add_value(const T& value, std::false_type /* integral */)
+      {
+        _write_floating_point(static_cast<double>(value));
+      }
+
+      void add_value(bool value)
+      {
+        _write_boolean(value);
+      }
+
+      void add_value(const std::string& value)
+      {
+        _write_text(value.data(), value.size());
+      }
+
+      void add_value(const char* value)
+      {
+        if (value)
+        {
+          _write_text(value, std::char_traits<char>::length(value));
+        }
+        else
+        {
+          _write_null();
+        }
+      }
+
+      void add_value(std::nullptr_t)
+      {
+        _write_null();
+      }
+
+      template <typename T>
+      typename std::enable_if<std::is_arithmetic<T>::value>::type add_value(const T& value)
+      {
+        add_value(value, std::is_integral<T>{});
+      }
+
+      void add_values()
+      {
+      }
+
+      template <typename T, typename... Rest>
+      void add_values(const T& value, const Rest&... rest)
+      {
+        add_value(value);
+        add_values(rest...);
+      }
+
+    public:
+      //! PostgreSQL accepts at most this many parameters per statement
+      static constexpr size_t max_parameters = 65535;
+
+      batch_insert_t() = default;
+      batch_insert_t(connection& db,
+                     const std::string& table,
+                     const std::vector<std::string>& columns,
+                     size_t max_rows);
+      batch_insert_t(const batch_insert_t&) = delete;
+      batch_insert_t(batch_insert_t&& other) = default;
+      batch_insert_t& operator=(const batch_insert_t&) = delete;
+      batch_insert_t& operator=(batch_insert_t&& other) = delete;
+      //! Sends the pending rows, errors are reported but not thrown
+      ~batch_insert_t();
+
+      //! Adds one row, values are given in the order of the columns passed to connection::batch_insert
+      template <typename... Values>
+      void add_row(const Values&... values)
+      {
+        add_values(values...);
+        _end_row();
+      }
+
+      //! Sends the pending rows, returns the number of rows inserted so far
+      size_t flush();
+
+      //! Number of rows added but not sent yet
+      size_t pending() const
+      {
+        return _ends.size() / (_columns ? _columns : 1);
+      }
+
+      //! Number of rows inserted so far
+      size_t inserted() const
+      {
+        return _inserted;
+      }
+
+      void _write_boolean(bool value);
+      void _write_floating_point(double value);
+      void _write_integral(int64_t value);
+      void _write_text(const char* value, size_t len);
+      void _write_null();
+      void _end_row();
+    };
+  }
+}
+
+#endif
@@ -28,7 +28,16 @@
 #ifndef SQLPP_POSTGRESQL_BIND_RESULT_H
 #define SQLPP_POSTGRESQL_BIND_RESULT_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
+
+#include <sqlpp11/postgresql/column_type.h>
+
+// Forward declaration of libpq's PGresult
+struct pg_result;
 
 namespace sqlpp
 {
@@ -36,24 +45,117 @@ namespace sqlpp
   {
     namespace detail
     {
-      struct prepared_statement_handle_t;
+      struct result_handle_t;
+      struct column_part_t;
     }
 
+    // Keeps a result alive after the prepared statement that produced it has
+    // been executed again, or a streaming or cursor select moved on to its next
+    // batch of rows. Views into the result stay valid as long as a pin exists.
+    class result_pin_t
+    {
+      std::shared_ptr<const pg_result> _result;
+
+    public:
+      result_pin_t() = default;
+      explicit result_pin_t(std::shared_ptr<const pg_result> result) : _result(std::move(result))
+      {
+      }
+
+      explicit operator bool() const
+      {
+        return static_cast<bool>(_result);
+      }
+
+      void reset()
+      {
+        _result.reset();
+      }
+    };
+
+    // Destination of one column for bind_result_t::fetch_columns(). Values are
+    // appended to the caller's vectors, nulls as 0 or an empty text. The optional
+    // validity bitmap receives one bit per row, least significant bit first,
+    // which is set for non-null values (the layout used by Apache Arrow).
+    class column_buffer_t
+    {
+    public:
+      enum class type_t
+      {
+        integral,
+        floating_point,
+        boolean,
+        text
+      };
+
+    private:
+      friend class bind_result_t;
+
+      size_t _index;
+      type_t _type;
+      void* _values;
+      std::vector<size_t>* _offsets{nullptr};
+      std::vector<uint8_t>* _validity;
+
+    public:
+      column_buffer_t(size_t index, std::vector<int64_t>& values, std::vector<uint8_t>* validity = nullptr)
+          : _index(index), _type(type_t::integral), _values(&values), _validity(validity)
+      {
+      }
+
+      column_buffer_t(size_t index, std::vector<double>& values, std::vector<uint8_t>* validity = nullptr)
+          : _index(index), _type(type_t::floating_point), _values(&values), _validity(validity)
+      {
+      }
+
+      column_buffer_t(size_t index, std::vector<signed char>& values, std::vector<uint8_t>* validity = nullptr)
+          : _index(index), _type(type_t::boolean), _values(&values), _validity(validity)
+      {
+      }
+
+      //! text values are appended to data back to back, offsets receives a leading 0 and the end of every value
+      column_buffer_t(size_t index,
+                      std::vector<char>& data,
+                      std::vector<size_t>& offsets,
+                      std::vector<uint8_t>* validity = nullptr)
+          : _index(index), _type(type_t::text), _values(&data), _offsets(&offsets), _validity(validity)
+      {
+      }
+
+      size_t index() const
+      {
+        return _index;
+      }
+
+      type_t type() const
+      {
+        return _type;
+      }
+    };
+
     class bind_result_t
     {
     private:
-      std::shared_ptr<detail::prepared_statement_handle_t> _handle;
+      std::unique_ptr<detail::result_handle_t> _handle;
 
       bool next_impl();
+      void check_column(size_t index) const;
+      void check_column_type(size_t index, unsigned int oid, wire_format_t format) const;
+      value_view_t raw_unchecked(size_t index) const;
+      static void decode_column(const pg_result* result, const column_buffer_t& column, int first_row, int rows);
+      //! a buffer for the same column and type, backed by part instead of the caller's vectors
+      static column_buffer_t part_buffer(const column_buffer_t& column, detail::column_part_t& part);
+      //! appends the rows decoded into part to column
+      static void merge_part(const column_buffer_t& column, const column_buffer_t& part);
 
     public:
-      bind_result_t() = default;
-      bind_result_t(const std::shared_ptr<detail::prepared_statement_handle_t>& handle);
+      bind_result_t();
+      bind_result_t(std::unique_ptr<detail::result_handle_t>&& handle);
       bind_result_t(const bind_result_t&) = delete;
-      bind_result_t(bind_result_t&&) = default;
+      bind_result_t(bind_result_t&&);
       bind_result_t& operator=(const bind_result_t&) = delete;
-      bind_result_t& operator=(bind_result_t&&) = default;
-      ~bind_result_t() = default;
+      bind_result_t& operator=(bind_result_t&&);
+      ~bind_result_t();
 
       bool operator==(const bind_result_t& rhs) const
       {
@@ -86,6 +188,61 @@ namespace sqlpp
         }
       }
 
+      // Direct access to the rows, without copying them into a result row.
+      // Views point into the current batch of rows and are invalidated by the
+      // batch moving on or the statement being executed again, unless pinned.
+
+      //! advances to the next row, returns false once all rows have been consumed
+      bool next_row()
+      {
+        return _handle && next_impl();
+      }
+
+      bool is_null(size_t index) const;
+
+      //! the text of a column; character types and jsonb in the binary format are supported too
+      value_view_t text(size_t index) const;
+
+      //! the raw bytes of a bytea column, requires connection_config::binary_results
+      value_view_t bytea(size_t index) const;
+
+      //! the bytes of a column as sent by the server, in the text or the binary format
+      value_view_t raw(size_t index) const;
+
+      //! checks that a column has the type and wire format recorded in Column's _postgresql_type by ddl2cpp.py.
+      // Throws otherwise. The result of a statement has the same layout in all rows and batches, so one
+      // check at the first row covers get<Column>() for all of them.
+      template <typename Column>
+      void expect_column(size_t index) const
+      {
+        check_column_type(index, Column::_postgresql_type::oid, Column::_postgresql_type::format);
+      }
+
+      //! the value of a column of the current row, decoded by the decoder Column's type selects at compile
+      // time without consulting the result's metadata. The column must have been checked with
+      // expect_column<Column>() and must not be null.
+      template <typename Column>
+      typename column_decoder_t<Column>::value_type get(size_t index) const
+      {
+        const value_view_t value = raw_unchecked(index);
+        return column_decoder_t<Column>::decode(value.data(), value.size());
+      }
+
+      //! shares ownership of the rows the current row belongs to
+      result_pin_t pin() const;
+
+      //! decodes all rows not visited yet, including further batches of streaming and cursor
+      // selects, column by column into the buffers. Returns the number of rows decoded.
+      size_t fetch_columns(const std::vector<column_buffer_t>& columns);
+
+      //! like fetch_columns(), decoding on several threads, 0 for one per core. The rows are split into tasks
+      // of task_rows rows, taken by the threads as they become idle; each task decodes into buffers of its
+      // own, which are appended to the columns' buffers in order once all rows have been decoded. Batches of
+      // streaming and cursor selects are received while the threads decode the previous ones.
+      size_t fetch_columns_parallel(const std::vector<column_buffer_t>& columns,
+                                    size_t threads = 0,
+                                    size_t task_rows = 16384);
+
       void _bind_boolean_result(size_t index, signed char* value, bool* is_null);
       void _bind_floating_point_result(size_t index, double* value, bool* is_null);
       void _bind_integral_result(size_t index, int64_t* value, bool* is_null);
@@ -0,0 +1,353 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef SQLPP_POSTGRESQL_COLUMN_TYPE_H
+#define SQLPP_POSTGRESQL_COLUMN_TYPE_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <sqlpp11/postgresql/numeric_format.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    // A column value inside a result, not copied and not NUL terminated. It is
+    // valid as long as the result it points into, see result_pin_t.
+    class value_view_t
+    {
+      const char* _data{nullptr};
+      size_t _size{0};
+
+    public:
+      value_view_t() = default;
+      value_view_t(const char* data, size_t size) : _data(data), _size(size)
+      {
+      }
+
+      const char* data() const
+      {
+        return _data;
+      }
+
+      size_t size() const
+      {
+        return _size;
+      }
+
+      bool empty() const
+      {
+        return _size == 0;
+      }
+
+      const char* begin() const
+      {
+        return _data;
+      }
+
+      const char* end() const
+      {
+        return _data + _size;
+      }
+
+      std::string str() const
+      {
+        return std::string(_data, _size);
+      }
+    };
+
+    namespace detail
+    {
+      // Values in the binary wire format are sent in network byte order.
+      inline uint16_t read_uint16(const char* data)
+      {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+      }
+
+      inline uint32_t read_uint32(const char* data)
+      {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+      }
+
+      inline uint64_t read_uint64(const char* data)
+      {
+        return (static_cast<uint64_t>(read_uint32(data)) << 32) | read_uint32(data + 4);
+      }
+
+      inline float read_float4(const char* data)
+      {
+        uint32_t bits = read_uint32(data);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+      }
+
+      inline double read_float8(const char* data)
+      {
+        uint64_t bits = read_uint64(data);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+      }
+
+      // numeric is sent as a sequence of base 10000 digits:
+      // int16 ndigits, int16 weight, uint16 sign, uint16 dscale, int16 digits[ndigits]
+      inline double read_numeric(const char* data)
+      {
+        const int16_t ndigits = static_cast<int16_t>(read_uint16(data));
+        const int16_t weight = static_cast<int16_t>(read_uint16(data + 2));
+        const uint16_t sign = read_uint16(data + 4);
+        switch (sign)
+        {
+          case 0xC000:
+            return NAN;
+          case 0xD000:
+            return INFINITY;
+          case 0xF000:
+            return -INFINITY;
+          default:
+            break;
+        }
+
+        double value = 0.0;
+        for (int16_t i = 0; i < ndigits; ++i)
+        {
+          value = value * 10000.0 + read_uint16(data + 8 + 2 * i);
+        }
+        value *= std::pow(10000.0, weight - ndigits + 1);
+        return sign == 0x4000 ? -value : value;
+      }
+    }
+
+    enum class wire_format_t
+    {
+      text,
+      binary
+    };
+
+    // The type OID and result format of a column as known when the code was
+    // generated. ddl2cpp.py emits it as the column's _postgresql_type, which
+    // selects the column's decoder_t at compile time.
+    template <unsigned int Oid, wire_format_t Format>
+    struct column_type_t
+    {
+      static constexpr unsigned int oid = Oid;
+      static constexpr wire_format_t format = Format;
+    };
+
+    // Decodes a non-null value of a type in a wire format into its C++ value.
+    // Only the supported combinations are specialized, others fail to compile.
+    template <unsigned int Oid, wire_format_t Format>
+    struct decoder_t;
+
+    namespace detail
+    {
+      template <typename T>
+      struct text_integral_decoder_t
+      {
+        using value_type = T;
+        static value_type decode(const char* data, size_t)
+        {
+          return static_cast<value_type>(std::strtoll(data, nullptr, 10));
+        }
+      };
+
+      template <typename T>
+      struct text_floating_point_decoder_t
+      {
+        using value_type = T;
+        static value_type decode(const char* data, size_t)
+        {
+          return static_cast<value_type>(parse_double(data));
+        }
+      };
+
+      struct text_decoder_t
+      {
+        using value_type = value_view_t;
+        static value_type decode(const char* data, size_t size)
+        {
+          return {data, size};
+        }
+      };
+    }
+
+    // bool
+    template <>
+    struct decoder_t<16, wire_format_t::binary>
+    {
+      using value_type = bool;
+      static value_type decode(const char* data, size_t)
+      {
+        return *data != 0;
+      }
+    };
+    template <>
+    struct decoder_t<16, wire_format_t::text>
+    {
+      using value_type = bool;
+      static value_type decode(const char* data, size_t)
+      {
+        return *data == 't';
+      }
+    };
+
+    // int8
+    template <>
+    struct decoder_t<20, wire_format_t::binary>
+    {
+      using value_type = int64_t;
+      static value_type decode(const char* data, size_t)
+      {
+        return static_cast<int64_t>(detail::read_uint64(data));
+      }
+    };
+    template <>
+    struct decoder_t<20, wire_format_t::text> : detail::text_integral_decoder_t<int64_t>
+    {
+    };
+
+    // int2
+    template <>
+    struct decoder_t<21, wire_format_t::binary>
+    {
+      using value_type = int16_t;
+      static value_type decode(const char* data, size_t)
+      {
+        return static_cast<int16_t>(detail::read_uint16(data));
+      }
+    };
+    template <>
+    struct decoder_t<21, wire_format_t::text> : detail::text_integral_decoder_t<int16_t>
+    {
+    };
+
+    // int4
+    template <>
+    struct decoder_t<23, wire_format_t::binary>
+    {
+      using value_type = int32_t;
+      static value_type decode(const char* data, size_t)
+      {
+        return static_cast<int32_t>(detail::read_uint32(data));
+      }
+    };
+    template <>
+    struct decoder_t<23, wire_format_t::text> : detail::text_integral_decoder_t<int32_t>
+    {
+    };
+
+    // oid
+    template <>
+    struct decoder_t<26, wire_format_t::binary>
+    {
+      using value_type = uint32_t;
+      static value_type decode(const char* data, size_t)
+      {
+        return detail::read_uint32(data);
+      }
+    };
+    template <>
+    struct decoder_t<26, wire_format_t::text> : detail::text_integral_decoder_t<uint32_t>
+    {
+    };
+
+    // float4
+    template <>
+    struct decoder_t<700, wire_format_t::binary>
+    {
+      using value_type = float;
+      static value_type decode(const char* data, size_t)
+      {
+        return detail::read_float4(data);
+      }
+    };
+    template <>
+    struct decoder_t<700, wire_format_t::text> : detail::text_floating_point_decoder_t<float>
+    {
+    };
+
+    // float8
+    template <>
+    struct decoder_t<701, wire_format_t::binary>
+    {
+      using value_type = double;
+      static value_type decode(const char* data, size_t)
+      {
+        return detail::read_float8(data);
+      }
+    };
+    template <>
+    struct decoder_t<701, wire_format_t::text> : detail::text_floating_point_decoder_t<double>
+    {
+    };
+
+    // numeric, as a double like the connector's floating_point binding
+    template <>
+    struct decoder_t<1700, wire_format_t::binary>
+    {
+      using value_type = double;
+      static value_type decode(const char* data, size_t)
+      {
+        return detail::read_numeric(data);
+      }
+    };
+    template <>
+    struct decoder_t<1700, wire_format_t::text> : detail::text_floating_point_decoder_t<double>
+    {
+    };
+
+    // text, varchar and bpchar, whose binary representation is the text itself
+    template <wire_format_t Format>
+    struct decoder_t<25, Format> : detail::text_decoder_t
+    {
+    };
+    template <wire_format_t Format>
+    struct decoder_t<1042, Format> : detail::text_decoder_t
+    {
+    };
+    template <wire_format_t Format>
+    struct decoder_t<1043, Format> : detail::text_decoder_t
+    {
+    };
+
+    //! the decoder selected by the _postgresql_type of a ddl2cpp generated column
+    template <typename Column>
+    using column_decoder_t = decoder_t<Column::_postgresql_type::oid, Column::_postgresql_type::format>;
+  }
+}
+
+#endif
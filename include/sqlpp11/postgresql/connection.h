@@ -31,10 +31,23 @@
 #include <sqlpp11/connection.h>
 #include <sqlpp11/serialize.h>
 #include <sqlpp11/postgresql/connection_config.h>
+#include <sqlpp11/type_traits.h>
+#include <sqlpp11/postgresql/batch_insert.h>
 #include <sqlpp11/postgresql/bind_result.h>
+#include <sqlpp11/postgresql/copy_in.h>
+#include <sqlpp11/postgresql/copy_out.h>
+#include <sqlpp11/postgresql/notification.h>
+#include <sqlpp11/postgresql/numeric_format.h>
 #include <sqlpp11/postgresql/prepared_statement.h>
 
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <functional>
 #include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 struct pg_conn;
 typedef struct pg_conn PGconn;
@@ -51,30 +64,115 @@ namespace sqlpp
 
     // Forward declaration
     class connection;
+    class pipeline_t;
+    class routing_pool;
+    class savepoint_t;
+    class scoped_statement_timeout_t;
+
+    enum class isolation_level_t
+    {
+      server_default,
+      read_committed,
+      repeatable_read,
+      serializable
+    };
+
+    // An insert serialized with a RETURNING clause for one column, see
+    // connection::insert_returning()
+    template <typename Insert, typename Column>
+    struct returning_t
+    {
+      const Insert& _insert;
+    };
+
+    template <typename Insert, typename Column>
+    returning_t<Insert, Column> returning(const Insert& i, const Column&)
+    {
+      return {i};
+    }
+
+    // A string to be escaped when it is written to a context_t
+    struct escaped_t
+    {
+      const connection& db;
+      const std::string& value;
+
+      operator std::string() const;
+    };
 
     // Context
+    // SQL is serialized straight into a std::string. The context borrows the
+    // connection's spare buffer while it exists and hands it back afterwards,
+    // so serializing a statement on a connection does not allocate once the
+    // buffer has grown to the size of the statements it is used for.
     struct context_t
     {
-      context_t(const connection& db) : _db(db)
-      {
-      }
+      context_t(const connection& db);
       context_t(const connection&&) = delete;
+      context_t(const context_t&) = delete;
+      context_t& operator=(const context_t&) = delete;
+      ~context_t();
 
+      context_t& operator<<(const std::string& t)
+      {
+        _sql.append(t);
+        return *this;
+      }
+      context_t& operator<<(const char* t)
+      {
+        _sql.append(t);
+        return *this;
+      }
+      context_t& operator<<(char t)
+      {
+        _sql.push_back(t);
+        return *this;
+      }
+      //! escapes directly into the buffer
+      context_t& operator<<(const escaped_t& t);
+      context_t& operator<<(bool t)
+      {
+        _sql.append(t ? "TRUE" : "FALSE");
+        return *this;
+      }
+      template <typename T>
+      typename std::enable_if<std::is_integral<T>::value, context_t&>::type operator<<(T t)
+      {
+        char data[24];
+        const int length = std::is_signed<T>::value
+                               ? std::snprintf(data, sizeof(data), "%lld", static_cast<long long>(t))
+                               : std::snprintf(data, sizeof(data), "%llu", static_cast<unsigned long long>(t));
+        _sql.append(data, static_cast<size_t>(length));
+        return *this;
+      }
       template <typename T>
-      std::ostream& operator<<(T t)
+      typename std::enable_if<std::is_floating_point<T>::value, context_t&>::type operator<<(T t)
       {
-        return _os << t;
+        // Same as the default formatting of an ostream in the classic locale
+        char data[32];
+        const int length = detail::format_double(data, sizeof(data), "%g", static_cast<double>(t));
+        _sql.append(data, static_cast<size_t>(length));
+        return *this;
       }
-      std::ostream& operator<<(bool t)
+      //! anything else that can be written to an ostream
+      template <typename T>
+      typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_convertible<T, const char*>::value &&
+                                  !std::is_convertible<T, std::string>::value,
+                              context_t&>::type
+      operator<<(const T& t)
       {
-        return _os << (t ? "TRUE" : "FALSE");
+        std::ostringstream os;
+        os << t;
+        _sql.append(os.str());
+        return *this;
       }
 
-      std::string escape(const std::string& arg);
+      escaped_t escape(const std::string& arg);
 
-      std::string str() const
+      //! the serialized SQL, valid as long as the context
+      const std::string& str() const
       {
-        return _os.str();
+        return _sql;
       }
 
       size_t count() const
@@ -88,31 +186,71 @@ namespace sqlpp
       }
 
       const connection& _db;
-      std::ostringstream _os;
+      std::string _sql;
       size_t _count{1};
+      // Set if _sql is the connection's buffer, nested contexts use a buffer of their own
+      bool _borrowed{false};
     };
 
+    // Completion callbacks of the asynchronous functions, the exception_ptr is set if the statement failed
+    using async_select_callback_t = std::function<void(bind_result_t, std::exception_ptr)>;
+    using async_execute_callback_t = std::function<void(size_t, std::exception_ptr)>;
+
     // Connection
     class connection : public sqlpp::connection
     {
+      friend batch_insert_t;
+      friend context_t;
+      friend routing_pool;
+      friend savepoint_t;
+
     private:
       std::unique_ptr<detail::connection_handle> _handle;
       bool _transaction_active{false};
+      // Spare serialization buffer, see context_t
+      mutable std::string _sql_buffer;
+      mutable bool _sql_buffer_in_use{false};
+
+      connection(std::unique_ptr<detail::connection_handle>&& handle);
 
       // direct execution
       bind_result_t select_impl(const std::string& stmt);
+      bind_result_t select_streaming_impl(const std::string& stmt, size_t chunk_rows);
+      bind_result_t select_cursor_impl(const std::string& stmt, size_t fetch_size);
       size_t insert_impl(const std::string& stmt);
+      std::vector<int64_t> insert_returning_impl(const std::string& stmt);
       size_t update_impl(const std::string& stmt);
       size_t remove_impl(const std::string& stmt);
 
+      // bulk loading
+      copy_in_t copy_into_impl(const std::string& table,
+                               const std::vector<std::string>& columns,
+                               copy_format_t format);
+      copy_out_t copy_out_impl(const std::string& source, copy_format_t format);
+      static std::string column_list(const std::vector<std::string>& columns);
+
       // prepared execution
       prepared_statement_t prepare_impl(const std::string& stmt, const size_t& paramCount);
       bind_result_t run_prepared_select_impl(prepared_statement_t& prep);
+      bind_result_t run_prepared_select_streaming_impl(prepared_statement_t& prep, size_t chunk_rows);
       size_t run_prepared_execute_impl(prepared_statement_t& prep);
       size_t run_prepared_insert_impl(prepared_statement_t& prep);
       size_t run_prepared_update_impl(prepared_statement_t& prep);
       size_t run_prepared_remove_impl(prepared_statement_t& prep);
 
+      // asynchronous execution, at most one statement is in flight
+      std::shared_ptr<detail::prepared_statement_handle_t> _async_result;
+      async_select_callback_t _async_select;
+      async_execute_callback_t _async_execute;
+      std::string _async_error;
+
+      void async_send(const std::string* stmt, const std::shared_ptr<detail::prepared_statement_handle_t>& prepared);
+      void async_complete();
+      void async_select_impl(const std::string& stmt, async_select_callback_t callback);
+      void async_execute_impl(const std::string& stmt, async_execute_callback_t callback);
+      void run_prepared_select_async_impl(prepared_statement_t& prep, async_select_callback_t callback);
+      void run_prepared_execute_async_impl(prepared_statement_t& prep, async_execute_callback_t callback);
+
     public:
       using _prepared_statement_t = prepared_statement_t;
       using _context_t = context_t;
@@ -139,6 +277,9 @@ namespace sqlpp
       // ctor / dtor
       connection(const std::shared_ptr<connection_config>& config);
       ~connection();
+      //! opens count connections concurrently, the handshakes of all of them are overlapped
+      static std::vector<std::unique_ptr<connection>> connect_parallel(const std::shared_ptr<connection_config>& config,
+                                                                       size_t count);
       connection(const connection&) = delete;
       connection(connection&&);
       connection& operator=(const connection&) = delete;
@@ -165,10 +306,45 @@ namespace sqlpp
       template <typename PreparedSelect>
       bind_result_t run_prepared_select(const PreparedSelect& s)
       {
+        s._prepared_statement._reset();
         s._bind_params();
         return run_prepared_select_impl(s._prepared_statement);
       }
 
+      // Streaming select: rows are received while iterating instead of being
+      // buffered in memory as a whole. With libpq 17 or newer, chunk_rows > 1
+      // fetches rows in chunks of that size, otherwise one row at a time.
+      // Destroying the result or executing another statement before all rows
+      // have been read abandons the rest. Outside of transactions the server is
+      // asked to stop sending them, inside of one they are read and discarded,
+      // as cancelling the statement would fail the transaction.
+      template <typename Select>
+      bind_result_t select_streaming(const Select& s, size_t chunk_rows = 1)
+      {
+        _context_t ctx(*this);
+        serialize(s, ctx);
+        return select_streaming_impl(ctx.str(), chunk_rows);
+      }
+
+      template <typename PreparedSelect>
+      bind_result_t run_prepared_select_streaming(const PreparedSelect& s, size_t chunk_rows = 1)
+      {
+        s._prepared_statement._reset();
+        s._bind_params();
+        return run_prepared_select_streaming_impl(s._prepared_statement, chunk_rows);
+      }
+
+      // Cursor select: DECLAREs a server side cursor and FETCHes fetch_size rows
+      // per round trip while iterating. Requires an active transaction, the
+      // cursor is closed with the result or when the transaction ends.
+      template <typename Select>
+      bind_result_t select_cursor(const Select& s, size_t fetch_size = 1000)
+      {
+        _context_t ctx(*this);
+        serialize(s, ctx);
+        return select_cursor_impl(ctx.str(), fetch_size);
+      }
+
       // Insert
       template <typename Insert>
       size_t insert(const Insert& i)
@@ -178,6 +354,16 @@ namespace sqlpp
         return insert_impl(ctx.str());
       }
 
+      //! runs the insert and returns the values of the column, typically a serial primary key, of all inserted
+      // rows from the same round trip, rather than asking for them with last_insert_id() afterwards
+      template <typename Insert, typename Column>
+      std::vector<int64_t> insert_returning(const Insert& i, const Column& column)
+      {
+        _context_t ctx(*this);
+        serialize(returning(i, column), ctx);
+        return insert_returning_impl(ctx.str());
+      }
+
       template <typename Insert>
       prepared_statement_t prepare_insert(Insert& i)
       {
@@ -189,6 +375,7 @@ namespace sqlpp
       template <typename PreparedInsert>
       size_t run_prepared_insert(const PreparedInsert& i)
       {
+        i._prepared_statement._reset();
         i._bind_params();
         return run_prepared_insert_impl(i._prepared_statement);
       }
@@ -213,6 +400,7 @@ namespace sqlpp
       template <typename PreparedUpdate>
       size_t run_prepared_update(const PreparedUpdate& u)
       {
+        u._prepared_statement._reset();
         u._bind_params();
         return run_prepared_update_impl(u._prepared_statement);
       }
@@ -237,10 +425,155 @@ namespace sqlpp
       template <typename PreparedRemove>
       size_t run_prepared_remove(const PreparedRemove& r)
       {
+        r._prepared_statement._reset();
         r._bind_params();
         return run_prepared_remove_impl(r._prepared_statement);
       }
 
+      // Bulk load with COPY ... FROM STDIN into the given columns of a table
+      template <typename Table, typename... Columns>
+      copy_in_t copy_into(copy_format_t format, const Table&, const Columns&...)
+      {
+        return copy_into_impl(name_of<Table>::char_ptr(), {name_of<Columns>::char_ptr()...}, format);
+      }
+
+      template <typename Table, typename... Columns>
+      copy_in_t copy_into(const Table& table, const Columns&... columns)
+      {
+        return copy_into(copy_format_t::text, table, columns...);
+      }
+
+      // Batched insert with multi-row INSERT ... VALUES statements of up to
+      // max_rows rows into the given columns of a table
+      template <typename Table, typename... Columns>
+      batch_insert_t batch_insert(size_t max_rows, const Table&, const Columns&...)
+      {
+        return batch_insert_t(*this, name_of<Table>::char_ptr(), {name_of<Columns>::char_ptr()...}, max_rows);
+      }
+
+      template <typename Table,
+                typename... Columns,
+                typename = typename std::enable_if<!std::is_arithmetic<Table>::value>::type>
+      batch_insert_t batch_insert(const Table&, const Columns&...)
+      {
+        return batch_insert_t(*this, name_of<Table>::char_ptr(), {name_of<Columns>::char_ptr()...}, 1000);
+      }
+
+      // Bulk export with COPY ... TO STDOUT from the given columns of a table
+      template <typename Table, typename... Columns>
+      copy_out_t copy_out(copy_format_t format, const Table&, const Columns&...)
+      {
+        return copy_out_impl(std::string(name_of<Table>::char_ptr()) + " (" +
+                                 column_list({name_of<Columns>::char_ptr()...}) + ")",
+                             format);
+      }
+
+      template <typename Table, typename... Columns>
+      copy_out_t copy_out(const Table& table, const Columns&... columns)
+      {
+        return copy_out(copy_format_t::text, table, columns...);
+      }
+
+      // Bulk export of the result of a select with COPY (...) TO STDOUT
+      template <typename Select>
+      copy_out_t copy_out_select(const Select& s, copy_format_t format = copy_format_t::text)
+      {
+        _context_t ctx(*this);
+        serialize(s, ctx);
+        return copy_out_impl("(" + ctx.str() + ")", format);
+      }
+
+      // Asynchronous execution for event loops: the statement is sent without
+      // waiting for its result. Wait for socket() to become readable, then call
+      // consume_input(), which invokes the callback once the result is complete.
+      // While flush() returns false, also wait for socket() to become writable
+      // and call flush() again. No other statement may be executed on the
+      // connection while an asynchronous one is pending, synchronous calls throw.
+      template <typename Select>
+      void async_select(const Select& s, async_select_callback_t callback)
+      {
+        _context_t ctx(*this);
+        serialize(s, ctx);
+        async_select_impl(ctx.str(), std::move(callback));
+      }
+
+      template <typename Execute>
+      void async_execute(const Execute& x, async_execute_callback_t callback)
+      {
+        _context_t ctx(*this);
+        serialize(x, ctx);
+        async_execute_impl(ctx.str(), std::move(callback));
+      }
+
+      void async_execute(const std::string& command, async_execute_callback_t callback)
+      {
+        async_execute_impl(command, std::move(callback));
+      }
+
+      template <typename PreparedSelect>
+      void run_prepared_select_async(const PreparedSelect& s, async_select_callback_t callback)
+      {
+        s._prepared_statement._reset();
+        s._bind_params();
+        run_prepared_select_async_impl(s._prepared_statement, std::move(callback));
+      }
+
+      //! Runs a prepared insert, update, remove or execute, the callback receives the affected rows
+      template <typename PreparedExecute>
+      void run_prepared_execute_async(const PreparedExecute& x, async_execute_callback_t callback)
+      {
+        x._prepared_statement._reset();
+        x._bind_params();
+        run_prepared_execute_async_impl(x._prepared_statement, std::move(callback));
+      }
+
+      //! The connection's socket, to be registered with an event loop
+      int socket() const;
+
+      //! Reads available input without blocking and dispatches notifications. Returns true if no asynchronous
+      // statement is pending anymore.
+      bool consume_input();
+
+      //! Sends pending output without blocking. Returns true if everything has been sent.
+      bool flush();
+
+      //! True while reading the result of the pending statement would block
+      bool is_busy() const;
+
+      bool async_pending() const;
+
+      //! Blocks until the pending asynchronous statement is complete
+      void wait_async();
+
+      // Notifications
+      // A connection LISTENing on channels receives the NOTIFYs sent to them
+      // while it is idle as well as while it executes statements. libpq queues
+      // them; dispatch_notifications() hands them to the subscribers. Event
+      // loops wait for socket() to become readable and call consume_input(),
+      // which dispatches too, so one connection can serve many subscribers.
+
+      //! subscribes to a channel, the first subscription of a channel sends LISTEN. Returns an id for unlisten().
+      size_t listen(const std::string& channel, notification_callback_t callback);
+
+      //! ends a subscription, the last one of its channel sends UNLISTEN
+      void unlisten(size_t subscription);
+
+      //! sends a notification to a channel
+      void notify(const std::string& channel, const std::string& payload = "");
+
+      //! takes the next notification without blocking or dispatching it, returns false if there is none
+      bool next_notification(notification_t& notification);
+
+      //! reads available input without blocking and delivers the notifications received, returns their number
+      size_t dispatch_notifications();
+
+      //! waits for notifications up to timeout and delivers them, a negative timeout waits indefinitely
+      size_t wait_notifications(std::chrono::milliseconds timeout);
+
+      //! Starts a pipeline, statements queued on it are sent without waiting for each other's results.
+      //! The connection must not be used for anything else while the pipeline exists.
+      pipeline_t pipeline();
+
       // Execute
       size_t execute(const std::string& command);
 
@@ -270,9 +603,23 @@ namespace sqlpp
         return run_prepared_execute_impl(x._prepared_statement);
       }
 
+      //! prepares a statement given as SQL text with param_count parameters, e.g. a batch update through
+      // unnest(). The parameters are bound by index with bind_array() or the _bind_*_parameter() functions.
+      _prepared_statement_t prepare_execute(const std::string& stmt, size_t param_count);
+
+      //! executes a statement prepared from SQL text with the parameters bound since its last execution,
+      // which start out as null again afterwards. Returns the number of affected rows.
+      size_t run_prepared_execute(prepared_statement_t& prep);
+
+      //! like run_prepared_execute(), for statements returning rows
+      bind_result_t run_prepared_select(prepared_statement_t& prep);
+
       // escape argument
       std::string escape(const std::string& s) const;
 
+      //! appends the escaped argument to out, throws if it is not valid in the client encoding
+      void escape_append(std::string& out, const std::string& s) const;
+
       //! call run on the argument
       template <typename T>
       auto run(const T& t) -> decltype(t._run(*this))
@@ -325,6 +672,10 @@ namespace sqlpp
       //! start transaction
       void start_transaction();
 
+      //! start transaction with the given isolation level and access mode, which are set by the BEGIN itself
+      // With deferred_transactions in the config the BEGIN is only sent together with the first statement.
+      void start_transaction(isolation_level_t isolation, bool read_only = false);
+
       //! commit transaction (or throw transaction if transaction has
       // finished already)
       void commit_transaction();
@@ -335,19 +686,103 @@ namespace sqlpp
       //! report rollback failure
       void report_rollback_failure(const std::string& message) noexcept;
 
-      //! get the last inserted id for a certain table
+      //! starts a nested scope in the open transaction, rolled back to its savepoint unless released
+      savepoint_t start_savepoint();
+
+      //! creates a savepoint in the open transaction
+      void savepoint(const std::string& name);
+
+      //! releases the savepoint and all savepoints created after it, keeping their changes
+      void release_savepoint(const std::string& name);
+
+      //! undoes everything since the savepoint, which stays in place unless release is set
+      void rollback_to_savepoint(const std::string& name, bool release = false);
+
+      bool is_transaction_active() const
+      {
+        return _transaction_active;
+      }
+
+      //! true if the connection to the server is intact, as far as libpq knows without a round trip
+      bool is_valid() const;
+
+      //! sends an empty query to verify that the server responds, never throws
+      bool ping();
+
+      //! re-establishes a broken connection. Prepared statements and cursors of the old session are gone.
+      void reconnect();
+
+      // Statement timeout
+      // Statements exceeding the timeout are aborted by the server, which gets
+      // the timeout with the next statement in the same round trip. Blocking
+      // statements are also cancelled by the client once the deadline passed
+      // without an answer, and then throw.
+
+      //! sets the deadline of the statements executed from now on, 0 for none
+      void set_statement_timeout(std::chrono::milliseconds timeout);
+
+      //! the deadline of statements, initially connection_config::statement_timeout
+      std::chrono::milliseconds statement_timeout() const;
+
+      //! asks the server to cancel the statement in progress, safe to call from any thread except during
+      // reconnect(). Returns false if the request could not be sent; a statement that is cancelled fails.
+      bool cancel();
+
+      //! get the last inserted id for a certain table, insert_returning() saves the extra round trip
       uint64_t last_insert_id(const std::string& table, const std::string& fieldname);
 
+      //! statement cache statistics, to size connection_config::statement_cache_size
+      size_t statement_cache_hits() const;
+      size_t statement_cache_misses() const;
+      size_t statement_cache_size() const;
+
+      //! how long establishing the connection took, by phase
+      const connect_timings_t& connect_timings() const;
+
       ::PGconn* native_handle();
     };
 
-    inline std::string context_t::escape(const std::string& arg)
+    inline context_t::context_t(const connection& db) : _db(db)
+    {
+      if (!_db._sql_buffer_in_use)
+      {
+        _sql.swap(_db._sql_buffer);
+        _db._sql_buffer_in_use = true;
+        _borrowed = true;
+      }
+    }
+
+    inline context_t::~context_t()
+    {
+      if (_borrowed)
+      {
+        _sql.clear();
+        _sql.swap(_db._sql_buffer);
+        _db._sql_buffer_in_use = false;
+      }
+    }
+
+    inline escaped_t context_t::escape(const std::string& arg)
+    {
+      return {_db, arg};
+    }
+
+    inline context_t& context_t::operator<<(const escaped_t& t)
+    {
+      t.db.escape_append(_sql, t.value);
+      return *this;
+    }
+
+    inline escaped_t::operator std::string() const
     {
-      return _db.escape(arg);
+      return db.escape(value);
     }
   }
 }
 
 #include <sqlpp11/postgresql/serializer.h>
+#include <sqlpp11/postgresql/pipeline.h>
+#include <sqlpp11/postgresql/savepoint.h>
+#include <sqlpp11/postgresql/statement_timeout.h>
 
 #endif
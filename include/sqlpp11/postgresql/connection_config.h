@@ -28,12 +28,19 @@
 #ifndef SQLPP_POSTGRESQL_CONNECTION_CONFIG_H
 #define SQLPP_POSTGRESQL_CONNECTION_CONFIG_H
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 
 namespace sqlpp
 {
   namespace postgresql
   {
+    // Forward declaration
+    class instrumentation_t;
+
     struct connection_config
     {
       enum class sslmode_t
@@ -45,6 +52,8 @@ namespace sqlpp
         verify_ca,
         verify_full
       };
+      // host and hostaddr may be comma separated lists; libpq then tries the
+      // hosts in turn until one satisfies target_session_attrs
       std::string host;
       std::string hostaddr;
       uint32_t port{5432};
@@ -69,8 +78,30 @@ namespace sqlpp
       std::string requirepeer;
       std::string krbsrvname;
       std::string service;
+      // any, read-write, read-only, primary, standby or prefer-standby
+      std::string target_session_attrs;
+      // Try the hosts in random order, spreading connections over them (libpq 16 and later)
+      bool load_balance_hosts{false};
       // bool auto_reconnect {true};
       bool debug{false};
+      // Number of server side prepared statements kept per connection, keyed by
+      // their SQL text. Set to 0 to prepare every statement anew.
+      size_t statement_cache_size{64};
+      // Request results in the binary format. Integral, floating point and boolean
+      // columns are then decoded without parsing text.
+      bool binary_results{false};
+      // Send numeric, boolean and character parameters of prepared statements in
+      // the binary format. Costs one describe round trip per newly prepared statement.
+      bool binary_parameters{false};
+      // Defer the BEGIN of transactions until the first statement, which is then
+      // sent in the same round trip. Transactions without statements cost nothing.
+      bool deferred_transactions{false};
+      // Default deadline of every statement, 0 for none. The server aborts
+      // statements running longer and the client cancels them should the server
+      // not answer in time, see connection::set_statement_timeout().
+      std::chrono::milliseconds statement_timeout{0};
+      // Receives the timings of prepares, executions and fetches, see instrumentation.h
+      std::shared_ptr<instrumentation_t> instrumentation;
 
       bool operator==(const connection_config& other)
       {
@@ -82,13 +113,32 @@ namespace sqlpp
                 other.keepalives_count == keepalives_count && other.sslmode == sslmode &&
                 other.sslcompression == sslcompression && other.sslcert == sslcert && other.sslkey == sslkey &&
                 other.sslrootcert == sslrootcert && other.sslcrl == sslcrl && other.requirepeer == requirepeer &&
-                other.krbsrvname == krbsrvname && other.service == service && other.debug == debug);
+                other.krbsrvname == krbsrvname && other.service == service &&
+                other.target_session_attrs == target_session_attrs &&
+                other.load_balance_hosts == load_balance_hosts && other.debug == debug &&
+                other.statement_cache_size == statement_cache_size && other.binary_results == binary_results &&
+                other.binary_parameters == binary_parameters &&
+                other.deferred_transactions == deferred_transactions &&
+                other.statement_timeout == statement_timeout && other.instrumentation == instrumentation);
       }
       bool operator!=(const connection_config& other)
       {
         return !operator==(other);
       }
     };
+
+    // Time spent in the phases of establishing a connection. Host names are
+    // resolved while the connection attempt starts, so dns also contains the
+    // time taken to initiate the TCP connect; tls is the SSL negotiation and
+    // auth everything from the startup message to the ready connection.
+    struct connect_timings_t
+    {
+      std::chrono::microseconds dns{0};
+      std::chrono::microseconds tcp{0};
+      std::chrono::microseconds tls{0};
+      std::chrono::microseconds auth{0};
+      std::chrono::microseconds total{0};
+    };
   }
 }
 
@@ -0,0 +1,167 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_CONNECTION_POOL_H
+#define SQLPP_POSTGRESQL_CONNECTION_POOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sqlpp11/postgresql/connection.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    struct connection_pool_config
+    {
+      std::shared_ptr<connection_config> connection;
+      // Connections opened when the pool is created and never evicted for being idle
+      size_t min_size{1};
+      // Upper bound of open connections, get() waits when all of them are checked out
+      size_t max_size{8};
+      // Connections above min_size that have been idle this long are closed
+      std::chrono::seconds max_idle{300};
+      // Connections idle for longer than this are pinged before being handed out
+      std::chrono::seconds validate_after{30};
+      // How long get() waits for a connection to be returned, zero waits indefinitely
+      std::chrono::milliseconds checkout_timeout{0};
+    };
+
+    class connection_pool
+    {
+    public:
+      // A connection checked out of the pool, it is returned when this is destroyed
+      class pooled_connection
+      {
+        connection_pool* _pool{nullptr};
+        std::unique_ptr<connection> _connection;
+
+      public:
+        pooled_connection() = default;
+        pooled_connection(connection_pool& pool, std::unique_ptr<connection> conn)
+            : _pool(&pool), _connection(std::move(conn))
+        {
+        }
+        pooled_connection(const pooled_connection&) = delete;
+        pooled_connection(pooled_connection&&) = default;
+        pooled_connection& operator=(const pooled_connection&) = delete;
+        pooled_connection& operator=(pooled_connection&& other)
+        {
+          if (this != &other)
+          {
+            release();
+            _pool = other._pool;
+            _connection = std::move(other._connection);
+          }
+          return *this;
+        }
+        ~pooled_connection()
+        {
+          release();
+        }
+
+        //! returns the connection to the pool early
+        void release()
+        {
+          if (_connection)
+          {
+            _pool->release(std::move(_connection));
+          }
+        }
+
+        connection& operator*() const
+        {
+          return *_connection;
+        }
+
+        connection* operator->() const
+        {
+          return _connection.get();
+        }
+
+        connection* get() const
+        {
+          return _connection.get();
+        }
+
+        explicit operator bool() const
+        {
+          return static_cast<bool>(_connection);
+        }
+      };
+
+    private:
+      using clock_t = std::chrono::steady_clock;
+
+      struct idle_connection_t
+      {
+        std::unique_ptr<connection> conn;
+        clock_t::time_point since;
+      };
+
+      const connection_pool_config _config;
+      mutable std::mutex _mutex;
+      std::condition_variable _returned;
+      // Most recently returned last, so that checkout prefers warm connections
+      std::vector<idle_connection_t> _idle;
+      size_t _open{0};
+
+      void release(std::unique_ptr<connection> conn);
+      std::unique_ptr<connection> checkout();
+      std::unique_ptr<connection> open();
+      void close_expired(std::vector<std::unique_ptr<connection>>& expired);
+
+    public:
+      //! opens min_size connections up front
+      connection_pool(const connection_pool_config& config);
+      connection_pool(const connection_pool&) = delete;
+      connection_pool(connection_pool&&) = delete;
+      connection_pool& operator=(const connection_pool&) = delete;
+      connection_pool& operator=(connection_pool&&) = delete;
+      //! all connections have to be returned before the pool is destroyed
+      ~connection_pool();
+
+      //! checks out a connection, validating or reconnecting it if necessary
+      pooled_connection get();
+
+      //! closes connections above min_size that have been idle longer than max_idle
+      void evict_idle();
+
+      //! number of open connections, idle or checked out
+      size_t size() const;
+
+      //! number of connections waiting in the pool
+      size_t idle() const;
+    };
+  }
+}
+
+#endif
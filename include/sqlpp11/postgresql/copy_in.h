@@ -0,0 +1,154 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_COPY_IN_H
+#define SQLPP_POSTGRESQL_COPY_IN_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sqlpp11/postgresql/copy_format.h>
+
+struct pg_conn;
+typedef struct pg_conn PGconn;
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    // Bulk loader using COPY ... FROM STDIN. Rows are encoded into an internal
+    // buffer which is handed to libpq in large chunks.
+    class copy_in_t
+    {
+    private:
+      PGconn* _connection{nullptr};
+      copy_format_t _format{copy_format_t::text};
+      size_t _columns{0};
+      // Column types, needed to encode the binary format
+      std::vector<unsigned int> _types;
+      std::string _buffer;
+      size_t _column{0};
+      // Where the row being added starts in _buffer
+      size_t _row_start{0};
+      bool _active{false};
+      bool _debug{false};
+
+      void begin_field();
+      //! discards the row being added and throws
+      [[noreturn]] void reject_row(const std::string& message);
+      void flush();
+      void abort() noexcept;
+
+      template <typename T>
+      void add_value(const T& value, std::true_type /* integral */)
+      {
+        _write_integral(static_cast<int64_t>(value));
+      }
+
+      template <typename T>
+      void add_value(const T& value, std::false_type /* integral */)
+      {
+        _write_floating_point(static_cast<double>(value));
+      }
+
+      void add_value(bool value)
+      {
+        _write_boolean(value);
+      }
+
+      void add_value(const std::string& value)
+      {
+        _write_text(value.data(), value.size());
+      }
+
+      void add_value(const char* value)
+      {
+        if (value)
+        {
+          _write_text(value, std::char_traits<char>::length(value));
+        }
+        else
+        {
+          _write_null();
+        }
+      }
+
+      void add_value(std::nullptr_t)
+      {
+        _write_null();
+      }
+
+      template <typename T>
+      typename std::enable_if<std::is_arithmetic<T>::value>::type add_value(const T& value)
+      {
+        add_value(value, std::is_integral<T>{});
+      }
+
+      void add_values()
+      {
+      }
+
+      template <typename T, typename... Rest>
+      void add_values(const T& value, const Rest&... rest)
+      {
+        add_value(value);
+        add_values(rest...);
+      }
+
+    public:
+      copy_in_t() = default;
+      copy_in_t(PGconn* connection, copy_format_t format, size_t columns, std::vector<unsigned int> types, bool debug);
+      copy_in_t(const copy_in_t&) = delete;
+      copy_in_t(copy_in_t&& other);
+      copy_in_t& operator=(const copy_in_t&) = delete;
+      copy_in_t& operator=(copy_in_t&& other) = delete;
+      ~copy_in_t();
+
+      //! Adds one row, values are given in the order of the columns passed to connection::copy_into
+      template <typename... Values>
+      void add_row(const Values&... values)
+      {
+        add_values(values...);
+        _end_row();
+      }
+
+      //! Sends the remaining rows and ends the COPY, returns the number of rows loaded
+      size_t finish();
+
+      void _write_boolean(bool value);
+      void _write_floating_point(double value);
+      void _write_integral(int64_t value);
+      void _write_text(const char* value, size_t len);
+      void _write_null();
+      void _end_row();
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_COPY_OUT_H
+#define SQLPP_POSTGRESQL_COPY_OUT_H
+
+#include <cstddef>
+
+#include <sqlpp11/postgresql/copy_format.h>
+
+struct pg_conn;
+typedef struct pg_conn PGconn;
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    // Bulk export using COPY ... TO STDOUT. In the text format every buffer
+    // holds one row including its terminating newline, in the binary format
+    // the buffers follow the row boundaries of the COPY binary file format.
+    // Destroying it before the end of the data abandons the rest. Outside of
+    // transactions the COPY is cancelled, inside of one the remaining data is
+    // read and discarded, as cancelling would fail the transaction.
+    class copy_out_t
+    {
+    private:
+      PGconn* _connection{nullptr};
+      char* _buffer{nullptr};
+      size_t _rows{0};
+      bool _active{false};
+      bool _cancel_on_abandon{false};
+      bool _debug{false};
+
+      void release_buffer();
+      void abort() noexcept;
+
+    public:
+      copy_out_t() = default;
+      copy_out_t(PGconn* connection, bool cancel_on_abandon, bool debug);
+      copy_out_t(const copy_out_t&) = delete;
+      copy_out_t(copy_out_t&& other);
+      copy_out_t& operator=(const copy_out_t&) = delete;
+      copy_out_t& operator=(copy_out_t&& other) = delete;
+      ~copy_out_t();
+
+      //! Receives the next buffer, which stays valid until the next call. Returns false at the end of the data.
+      bool next(const char** data, size_t* len);
+
+      //! Calls callback(const char* data, size_t len) for every buffer, returns the number of buffers received
+      template <typename Callback>
+      size_t for_each(Callback callback)
+      {
+        const char* data;
+        size_t len;
+        size_t count = 0;
+        while (next(&data, &len))
+        {
+          callback(data, len);
+          ++count;
+        }
+        return count;
+      }
+
+      //! Number of rows reported by the server, available once next() returned false
+      size_t rows() const
+      {
+        return _rows;
+      }
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_INSTRUMENTATION_H
+#define SQLPP_POSTGRESQL_INSTRUMENTATION_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    // Receives timings and sizes of the statements executed on connections
+    // whose connection_config::instrumentation is set. Callbacks run on the
+    // thread using the connection and should return quickly, e.g. by feeding
+    // a histogram. Without instrumentation the cost is a single null check
+    // per statement; building with SQLPP_POSTGRESQL_NO_INSTRUMENTATION removes
+    // even that.
+    class instrumentation_t
+    {
+    public:
+      virtual ~instrumentation_t() = default;
+
+      //! A statement has been prepared. If cached, the statement cache already had it and
+      // no round trip was needed.
+      virtual void on_prepare(const std::string& /* statement */,
+                              std::chrono::nanoseconds /* duration */,
+                              bool /* cached */)
+      {
+      }
+
+      //! A statement has been executed until its result arrived. For streaming and cursor
+      // selects this is the time until the statement was sent or declared, the rows are
+      // reported by on_fetch.
+      virtual void on_execute(const std::string& /* statement */,
+                              std::chrono::nanoseconds /* duration */,
+                              size_t /* rows returned or affected */,
+                              size_t /* bytes of the returned values */)
+      {
+      }
+
+      //! A statement failed or was cancelled after exceeding its timeout, before the
+      // exception with the error is thrown. Statements are reported either here or by
+      // on_execute, never by both.
+      virtual void on_execute_failed(const std::string& /* statement */,
+                                     std::chrono::nanoseconds /* duration */,
+                                     const std::string& /* error */)
+      {
+      }
+
+      //! A batch of rows of a streaming or cursor select has been received
+      virtual void on_fetch(std::chrono::nanoseconds /* duration */, size_t /* rows */, size_t /* bytes */)
+      {
+      }
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,153 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_PIPELINE_H
+#define SQLPP_POSTGRESQL_PIPELINE_H
+
+#include <string>
+#include <vector>
+
+#include <sqlpp11/postgresql/connection.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    struct pipeline_result_t
+    {
+      enum class status_t
+      {
+        ok,          // executed successfully
+        failed,      // executed and failed, see error
+        aborted,     // not executed, an earlier statement of the same sync failed
+        rolled_back  // executed successfully, but undone because a later statement of the same
+                     // sync failed outside of an explicit transaction
+      };
+
+      status_t status{status_t::ok};
+      size_t affected_rows{0};
+      std::string error;
+      // The rows returned by a select
+      bind_result_t result;
+    };
+
+    // Queues statements using libpq's pipeline mode. Statements are sent
+    // without waiting for each other's results, sync() then collects all
+    // results in the order the statements were queued, paying one round trip
+    // for the whole batch.
+    //
+    // Error semantics follow the server's: if a statement fails, every
+    // statement queued after it up to the next sync() is aborted. Outside of
+    // an explicit transaction the statements of one sync() run in an implicit
+    // transaction, so the ones before the failure are rolled back as well.
+    // Inside a transaction, the transaction is aborted and has to be rolled back.
+    class pipeline_t
+    {
+    private:
+      connection* _db{nullptr};
+      detail::connection_handle* _handle{nullptr};
+      size_t _queued{0};
+      bool _transaction_active{false};
+
+      void queue_prepared(prepared_statement_t& prep);
+      void queue_direct(const std::string& stmt);
+
+    public:
+      pipeline_t() = default;
+      pipeline_t(connection& db, detail::connection_handle& handle, bool transaction_active);
+      pipeline_t(const pipeline_t&) = delete;
+      pipeline_t(pipeline_t&& other);
+      pipeline_t& operator=(const pipeline_t&) = delete;
+      pipeline_t& operator=(pipeline_t&&) = delete;
+      //! Syncs statements still queued, discarding their results, and leaves pipeline mode
+      ~pipeline_t();
+
+      template <typename PreparedStatement>
+      void run_prepared(const PreparedStatement& p)
+      {
+        p._prepared_statement._reset();
+        p._bind_params();
+        queue_prepared(p._prepared_statement);
+      }
+
+      template <typename PreparedSelect>
+      void run_prepared_select(const PreparedSelect& s)
+      {
+        run_prepared(s);
+      }
+
+      template <typename PreparedInsert>
+      void run_prepared_insert(const PreparedInsert& i)
+      {
+        run_prepared(i);
+      }
+
+      template <typename PreparedUpdate>
+      void run_prepared_update(const PreparedUpdate& u)
+      {
+        run_prepared(u);
+      }
+
+      template <typename PreparedRemove>
+      void run_prepared_remove(const PreparedRemove& r)
+      {
+        run_prepared(r);
+      }
+
+      template <typename PreparedExecute>
+      void run_prepared_execute(const PreparedExecute& x)
+      {
+        run_prepared(x);
+      }
+
+      //! Queues a statement for direct execution
+      template <typename Statement>
+      void execute(const Statement& x)
+      {
+        context_t ctx(*_db);
+        serialize(x, ctx);
+        queue_direct(ctx.str());
+      }
+
+      void execute(const std::string& command)
+      {
+        queue_direct(command);
+      }
+
+      //! Number of statements queued since the last sync
+      size_t queued() const
+      {
+        return _queued;
+      }
+
+      //! Sends a sync point and returns the results of all queued statements in order
+      std::vector<pipeline_result_t> sync();
+    };
+  }
+}
+
+#endif
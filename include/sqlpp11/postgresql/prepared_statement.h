@@ -28,8 +28,10 @@
 #ifndef SQLPP_POSTGRESQL_PREPARED_STATEMENT_H
 #define SQLPP_POSTGRESQL_PREPARED_STATEMENT_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace sqlpp
 {
@@ -37,6 +39,8 @@ namespace sqlpp
   {
     // Forward declaration
     class connection;
+    class batch_insert_t;
+    class pipeline_t;
 
     // Detail namespace
     namespace detail
@@ -47,6 +51,8 @@ namespace sqlpp
     class prepared_statement_t
     {
       friend sqlpp::postgresql::connection;
+      friend sqlpp::postgresql::pipeline_t;
+      friend sqlpp::postgresql::batch_insert_t;
 
     private:
       std::shared_ptr<detail::prepared_statement_handle_t> _handle;
@@ -65,10 +71,28 @@ namespace sqlpp
         return (this->_handle == rhs._handle);
       }
 
+      //! Discards the bound parameters, called before binding them for the next execution
+      void _reset();
+
       void _bind_boolean_parameter(size_t index, const signed char* value, bool is_null);
       void _bind_floating_point_parameter(size_t index, const double* value, bool is_null);
       void _bind_integral_parameter(size_t index, const int64_t* value, bool is_null);
       void _bind_text_parameter(size_t index, const std::string* value, bool is_null);
+
+      // Array parameters, index counts from 0 for $1. With unnest($1::bigint[], $2::text[]) one execution
+      // processes a whole batch of rows. The optional validity bitmap holds one bit per value, least
+      // significant bit first, which is cleared for nulls (the layout fetch_columns() produces). Arrays are
+      // sent in the binary format if connection_config::binary_parameters is set and the server inferred
+      // an array of a matching type, otherwise as array literals.
+      void bind_array(size_t index, const std::vector<int64_t>& values, const std::vector<uint8_t>* validity = nullptr);
+      void bind_array(size_t index, const std::vector<double>& values, const std::vector<uint8_t>* validity = nullptr);
+      //! booleans, as from a boolean column_buffer_t
+      void bind_array(size_t index,
+                      const std::vector<signed char>& values,
+                      const std::vector<uint8_t>* validity = nullptr);
+      void bind_array(size_t index,
+                      const std::vector<std::string>& values,
+                      const std::vector<uint8_t>* validity = nullptr);
     };
   }
 }
@@ -0,0 +1,189 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef SQLPP_POSTGRESQL_ROUTING_POOL_H
+#define SQLPP_POSTGRESQL_ROUTING_POOL_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sqlpp11/postgresql/connection_pool.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    struct routing_pool_config
+    {
+      enum class balancing_t
+      {
+        // the replica with the fewest connections checked out for reads
+        least_outstanding,
+        // outstanding reads weighted by the replica's average read latency
+        latency_weighted
+      };
+
+      connection_pool_config primary;
+      std::vector<connection_pool_config> replicas;
+      balancing_t balancing{balancing_t::least_outstanding};
+      // Replicas whose replay lags further behind the primary are not used for reads. Replicas not
+      // streaming WAL count as stale; reading their receiver state requires pg_read_all_stats.
+      std::chrono::milliseconds max_staleness{std::chrono::seconds(5)};
+      // How often the replay lag of a replica is measured, on a connection checked out for a read
+      std::chrono::milliseconds staleness_check_interval{std::chrono::seconds(1)};
+      // Send reads to the primary if no replica qualifies, instead of throwing
+      bool primary_fallback{true};
+    };
+
+    // Connection pools for a primary and its read replicas. write() hands out
+    // primary connections, for writes and transactions, read() replica
+    // connections that are fresh enough for max_staleness, balanced as
+    // configured. A single pool can also route by libpq's own multi-host
+    // support, see connection_config::target_session_attrs.
+    class routing_pool
+    {
+    public:
+      // A pooled connection that reports back to the routing pool when it is returned
+      class routed_connection
+      {
+        friend routing_pool;
+
+        routing_pool* _pool{nullptr};
+        size_t _backend{0};
+        std::chrono::steady_clock::time_point _since;
+        connection_pool::pooled_connection _connection;
+
+        routed_connection(routing_pool& pool, size_t backend, connection_pool::pooled_connection conn)
+            : _pool(&pool), _backend(backend), _since(std::chrono::steady_clock::now()), _connection(std::move(conn))
+        {
+        }
+
+      public:
+        routed_connection() = default;
+        routed_connection(const routed_connection&) = delete;
+        routed_connection(routed_connection&& other)
+            : _pool(other._pool),
+              _backend(other._backend),
+              _since(other._since),
+              _connection(std::move(other._connection))
+        {
+        }
+        routed_connection& operator=(const routed_connection&) = delete;
+        routed_connection& operator=(routed_connection&& other) = delete;
+        ~routed_connection()
+        {
+          release();
+        }
+
+        //! returns the connection to its pool early
+        void release();
+
+        //! true if this is a connection to the primary
+        bool is_primary() const
+        {
+          return _backend == 0;
+        }
+
+        connection& operator*() const
+        {
+          return *_connection;
+        }
+
+        connection* operator->() const
+        {
+          return _connection.get();
+        }
+
+        connection* get() const
+        {
+          return _connection.get();
+        }
+
+        explicit operator bool() const
+        {
+          return static_cast<bool>(_connection);
+        }
+      };
+
+    private:
+      using clock_t = std::chrono::steady_clock;
+
+      struct backend_t
+      {
+        std::unique_ptr<connection_pool> pool;
+        size_t outstanding{0};
+        // Moving average of the time reads held a connection, in microseconds
+        double latency{0};
+        std::chrono::milliseconds lag{0};
+        clock_t::time_point lag_checked;
+      };
+
+      const routing_pool_config _config;
+      mutable std::mutex _mutex;
+      // The primary first, then the replicas
+      std::vector<backend_t> _backends;
+      size_t _next{0};
+
+      routed_connection checkout(size_t backend);
+      size_t pick_replica(const std::vector<bool>& excluded);
+      void finished(size_t backend, clock_t::duration duration);
+
+    public:
+      routing_pool(const routing_pool_config& config);
+      routing_pool(const routing_pool&) = delete;
+      routing_pool(routing_pool&&) = delete;
+      routing_pool& operator=(const routing_pool&) = delete;
+      routing_pool& operator=(routing_pool&&) = delete;
+      ~routing_pool() = default;
+
+      //! checks out a primary connection, for writes and transactions
+      routed_connection write();
+
+      //! checks out a connection to a replica within max_staleness, or the primary as a fallback
+      routed_connection read();
+
+      //! runs a select on a replica; the result stays valid after the connection went back to its pool
+      template <typename Select>
+      bind_result_t select(const Select& s)
+      {
+        auto conn = read();
+        return conn->select(s);
+      }
+
+      //! the last measured replay lag of a replica, replicas are numbered from 0
+      std::chrono::milliseconds replica_lag(size_t replica) const;
+
+      //! reads currently checked out from a replica
+      size_t replica_outstanding(size_t replica) const;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef SQLPP_POSTGRESQL_SAVEPOINT_H
+#define SQLPP_POSTGRESQL_SAVEPOINT_H
+
+#include <cstdint>
+#include <string>
+
+#include <sqlpp11/postgresql/connection.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    // A nested transaction scope backed by a SAVEPOINT. Unless release() is
+    // called, the scope's changes are rolled back when it ends, so that a
+    // failed part of a transaction can be retried without restarting all of
+    // it. With deferred_transactions in the config, the SAVEPOINT, RELEASE and
+    // ROLLBACK TO commands travel with the next statement instead of costing
+    // a round trip of their own.
+    class savepoint_t
+    {
+    private:
+      connection* _db{nullptr};
+      std::string _name;
+      bool _finished{true};
+      // The connection's transaction_counter in the savepoint's transaction
+      uint64_t _transaction{0};
+
+      bool in_transaction() const;
+
+    public:
+      savepoint_t() = default;
+      savepoint_t(connection& db, std::string name);
+      savepoint_t(const savepoint_t&) = delete;
+      savepoint_t(savepoint_t&& other);
+      savepoint_t& operator=(const savepoint_t&) = delete;
+      savepoint_t& operator=(savepoint_t&& other) = delete;
+      ~savepoint_t();
+
+      //! keeps the scope's changes as part of the enclosing transaction
+      void release();
+
+      //! undoes the scope's changes
+      void rollback();
+
+      const std::string& name() const
+      {
+        return _name;
+      }
+    };
+  }
+}
+
+#endif
@@ -47,6 +47,20 @@ namespace sqlpp
       return context;
     }
   };
+
+  template <typename Insert, typename Column>
+  struct serializer_t<postgresql::context_t, postgresql::returning_t<Insert, Column>>
+  {
+    using _serialize_check = serialize_check_of<postgresql::context_t, Insert>;
+    using T = postgresql::returning_t<Insert, Column>;
+
+    static postgresql::context_t& _(const T& t, postgresql::context_t& context)
+    {
+      serialize(t._insert, context);
+      context << " RETURNING " << name_of<Column>::char_ptr();
+      return context;
+    }
+  };
 }
 
 #endif
@@ -0,0 +1,75 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_STATEMENT_TIMEOUT_H
+#define SQLPP_POSTGRESQL_STATEMENT_TIMEOUT_H
+
+#include <chrono>
+
+#include <sqlpp11/postgresql/connection.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    // Sets the statement timeout of a connection for the lifetime of the
+    // object, for per-call deadlines:
+    //
+    //   {
+    //     scoped_statement_timeout_t deadline(db, std::chrono::milliseconds(50));
+    //     db(select(...));
+    //   }
+    class scoped_statement_timeout_t
+    {
+    private:
+      connection& _db;
+      std::chrono::milliseconds _previous;
+
+    public:
+      scoped_statement_timeout_t(connection& db, std::chrono::milliseconds timeout);
+      scoped_statement_timeout_t(const scoped_statement_timeout_t&) = delete;
+      scoped_statement_timeout_t(scoped_statement_timeout_t&&) = delete;
+      scoped_statement_timeout_t& operator=(const scoped_statement_timeout_t&) = delete;
+      scoped_statement_timeout_t& operator=(scoped_statement_timeout_t&&) = delete;
+      //! restores the previous timeout
+      ~scoped_statement_timeout_t();
+    };
+
+    inline scoped_statement_timeout_t::scoped_statement_timeout_t(connection& db, std::chrono::milliseconds timeout)
+        : _db(db), _previous(db.statement_timeout())
+    {
+      _db.set_statement_timeout(timeout);
+    }
+
+    inline scoped_statement_timeout_t::~scoped_statement_timeout_t()
+    {
+      _db.set_statement_timeout(_previous);
+    }
+  }
+}
+
+#endif
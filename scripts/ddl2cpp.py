@@ -15,6 +15,8 @@ parser.add_argument('-p', '--password', dest='password', required=True, help='Po
 parser.add_argument('-d', '--dbname', dest='dbname', required=True, help='PostgreSQL database')
 parser.add_argument('-o', '--output-dir', dest='outputdir', help='Output directory', default='tables/')
 parser.add_argument('-n', '--namespace', dest='namespace', help='C++ namespace', default='model')
+parser.add_argument('-f', '--wire-format', dest='wireformat', choices=['text', 'binary'], default='text',
+                    help='Result format the columns are decoded from, binary if connection_config::binary_results is set')
 args = parser.parse_args()
 
 def _writeLine(fd, indent, line):
@@ -37,7 +39,9 @@ types = {
     'bool': 'boolean',
     'boolean': 'boolean',
     'double': 'floating_point',
+    'double precision': 'floating_point',
     'float': 'floating_point',
+    'real': 'floating_point',
     'numeric': 'floating_point',
 
     # For now keep this a varchar
@@ -65,6 +69,7 @@ for table in tables:
     _writeLine(fd, 0, "#include <sqlpp11/table.h>")
     _writeLine(fd, 0, "#include <sqlpp11/char_sequence.h>")
     _writeLine(fd, 0, "#include <sqlpp11/column_types.h>")
+    _writeLine(fd, 0, "#include <sqlpp11/postgresql/column_type.h>")
     _writeLine(fd, 0, "")
     _writeLine(fd, 0, "namespace " + args.namespace + " {")
     _writeLine(fd, 0, "")
@@ -73,6 +78,10 @@ for table in tables:
     # Fetch all columns for this table
     curs.execute("""SELECT * FROM information_schema.columns WHERE table_schema = 'public' AND table_name = '%s' ORDER BY table_name ASC, ordinal_position ASC""" % (table[0],))
     columns = curs.fetchall()
+
+    # The type OIDs of the columns, they select the decoders of bind_result_t::get()
+    curs.execute("""SELECT attname, atttypid FROM pg_attribute WHERE attrelid = %s::regclass AND attnum > 0 AND NOT attisdropped""", ('public."' + table[0] + '"',))
+    oids = dict(curs.fetchall())
     for column in columns:
         _writeLine(fd, 0, "")
         _writeLine(fd, 2, "struct " + column[3].capitalize() + " {")
@@ -105,6 +114,7 @@ for table in tables:
 
         _writeLine(fd, 0, "")
         _writeLine(fd, 3, traits + ">;")
+        _writeLine(fd, 3, "using _postgresql_type = ::sqlpp::postgresql::column_type_t<" + str(oids[column[3]]) + ", ::sqlpp::postgresql::wire_format_t::" + args.wireformat + ">;")
         _writeLine(fd, 2, "};")
 
     _writeLine(fd, 1, "}")
@@ -0,0 +1,261 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sqlpp11/postgresql/batch_insert.h>
+#include <sqlpp11/postgresql/connection.h>
+#include <sqlpp11/postgresql/numeric_format.h>
+#include <sqlpp11/exception.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "detail/prepared_statement_handle.h"
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    constexpr size_t batch_insert_t::max_parameters;
+
+    batch_insert_t::batch_insert_t(connection& db,
+                                   const std::string& table,
+                                   const std::vector<std::string>& columns,
+                                   size_t max_rows)
+        : _db(&db), _columns(columns.size())
+    {
+      if (_columns == 0 || _columns > max_parameters)
+      {
+        throw sqlpp::exception("PostgreSQL error: batch insert needs between 1 and 65535 columns");
+      }
+
+      _prefix = "INSERT INTO " + table + " (";
+      for (size_t i = 0; i < columns.size(); ++i)
+      {
+        if (i > 0)
+        {
+          _prefix.push_back(',');
+        }
+        _prefix.append(columns[i]);
+      }
+      _prefix.append(") VALUES ");
+
+      _max_rows = std::max<size_t>(1, std::min(max_rows, max_parameters / _columns));
+      _ends.reserve(_max_rows * _columns);
+      _nulls.reserve(_max_rows * _columns);
+    }
+
+    batch_insert_t::~batch_insert_t()
+    {
+      try
+      {
+        if (_db && pending() > 0)
+        {
+          flush();
+        }
+      }
+      catch (const sqlpp::exception& e)
+      {
+        std::cerr << "PostgreSQL error: " << e.what() << std::endl;
+      }
+    }
+
+    void batch_insert_t::send(size_t rows)
+    {
+      auto statement = _statements.find(rows);
+      if (statement == _statements.end())
+      {
+        // Parameters are numbered row by row: ($1,$2),($3,$4),...
+        std::string sql = _prefix;
+        size_t parameter = 0;
+        for (size_t row = 0; row < rows; ++row)
+        {
+          sql.append(row > 0 ? ",(" : "(");
+          for (size_t column = 0; column < _columns; ++column)
+          {
+            if (column > 0)
+            {
+              sql.push_back(',');
+            }
+            sql.append("$" + std::to_string(++parameter));
+          }
+          sql.push_back(')');
+        }
+        statement = _statements.emplace(rows, _db->prepare_impl(sql, parameter)).first;
+      }
+
+      prepared_statement_t& prep = statement->second;
+      detail::prepared_statement_handle_t& handle = *prep._handle;
+      prep._reset();
+      for (size_t i = 0; i < rows * _columns; ++i)
+      {
+        if (_nulls[i])
+        {
+          handle.set_param_null(i);
+          continue;
+        }
+        // Values are sent as text and converted by the server according to the column types
+        const size_t begin = i > 0 ? _ends[i - 1] : 0;
+        const size_t length = _ends[i] - begin;
+        char* storage = handle.param_storage(i, length + 1, 0);
+        std::memcpy(storage, _data.data() + begin, length);
+        storage[length] = '\0';
+      }
+      _inserted += _db->run_prepared_execute_impl(prep);
+    }
+
+    size_t batch_insert_t::flush()
+    {
+      if (_column != 0)
+      {
+        throw sqlpp::exception("PostgreSQL error: batch insert flushed in the middle of a row");
+      }
+
+      // Full chunks of max_rows are normally sent while adding rows, unless
+      // sending one failed. The remainder is split into power-of-two chunks,
+      // so at most log2(max_rows) further statement shapes are ever prepared.
+      size_t rows = pending();
+      while (rows > 0)
+      {
+        size_t chunk = _max_rows;
+        if (rows < _max_rows)
+        {
+          chunk = 1;
+          while (chunk * 2 <= rows)
+          {
+            chunk *= 2;
+          }
+        }
+        // Rows are dropped as soon as they are inserted, so a failing chunk
+        // leaves only the rows not inserted yet for the next flush
+        send(chunk);
+        drop_rows(chunk);
+        rows -= chunk;
+      }
+      return _inserted;
+    }
+
+    void batch_insert_t::drop_rows(size_t rows)
+    {
+      const size_t values = rows * _columns;
+      const size_t bytes = values > 0 ? _ends[values - 1] : 0;
+      _data.erase(0, bytes);
+      _ends.erase(_ends.begin(), _ends.begin() + static_cast<std::ptrdiff_t>(values));
+      _nulls.erase(_nulls.begin(), _nulls.begin() + static_cast<std::ptrdiff_t>(values));
+      for (auto& end : _ends)
+      {
+        end -= bytes;
+      }
+    }
+
+    void batch_insert_t::discard_row()
+    {
+      const size_t row_start = _ends.size() - _column;
+      _ends.resize(row_start);
+      _nulls.resize(row_start);
+      _data.resize(row_start > 0 ? _ends.back() : 0);
+      _column = 0;
+    }
+
+    void batch_insert_t::begin_field()
+    {
+      if (_column == _columns)
+      {
+        discard_row();
+        throw sqlpp::exception("PostgreSQL error: batch insert row has more values than columns");
+      }
+      ++_column;
+    }
+
+    void batch_insert_t::_write_boolean(bool value)
+    {
+      begin_field();
+      _data.push_back(value ? 't' : 'f');
+      _ends.push_back(_data.size());
+      _nulls.push_back(false);
+    }
+
+    void batch_insert_t::_write_floating_point(double value)
+    {
+      begin_field();
+      // The shortest representation that reads back to the same value
+      char data[32];
+      int length = detail::format_double(data, sizeof(data), "%.15g", value);
+      if (detail::parse_double(data) != value)
+      {
+        length = detail::format_double(data, sizeof(data), "%.17g", value);
+      }
+      _data.append(data, static_cast<size_t>(length));
+      _ends.push_back(_data.size());
+      _nulls.push_back(false);
+    }
+
+    void batch_insert_t::_write_integral(int64_t value)
+    {
+      begin_field();
+      char data[24];
+      int length = std::snprintf(data, sizeof(data), "%lld", static_cast<long long>(value));
+      _data.append(data, static_cast<size_t>(length));
+      _ends.push_back(_data.size());
+      _nulls.push_back(false);
+    }
+
+    void batch_insert_t::_write_text(const char* value, size_t len)
+    {
+      begin_field();
+      _data.append(value, len);
+      _ends.push_back(_data.size());
+      _nulls.push_back(false);
+    }
+
+    void batch_insert_t::_write_null()
+    {
+      begin_field();
+      _ends.push_back(_data.size());
+      _nulls.push_back(true);
+    }
+
+    void batch_insert_t::_end_row()
+    {
+      if (_column != _columns)
+      {
+        discard_row();
+        throw sqlpp::exception("PostgreSQL error: batch insert row has fewer values than columns");
+      }
+      _column = 0;
+
+      // A chunk that failed to go out stays buffered and is retried with the next row
+      while (pending() >= _max_rows)
+      {
+        send(_max_rows);
+        drop_rows(_max_rows);
+      }
+    }
+  }
+}
@@ -26,12 +26,21 @@
  */
 
 #include <sqlpp11/postgresql/bind_result.h>
+#include <sqlpp11/postgresql/numeric_format.h>
 #include <sqlpp11/exception.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
-#include <sstream>
+#include <list>
+#include <mutex>
+#include <thread>
 
-#include "detail/prepared_statement_handle.h"
+#include "detail/binary_format.h"
+#include "detail/instrumentation.h"
+#include "detail/result_handle.h"
 
 #if defined(_WIN32) || defined(_WIN64)
 #pragma warning (disable:4800)	// int to bool
@@ -41,7 +50,344 @@ namespace sqlpp
 {
   namespace postgresql
   {
-    bind_result_t::bind_result_t(const std::shared_ptr<detail::prepared_statement_handle_t>& handle) : _handle(handle)
+    namespace detail
+    {
+      // The rows of one column decoded by a task of fetch_columns_parallel(),
+      // only the vectors of the column's type are used
+      struct column_part_t
+      {
+        std::vector<int64_t> integral;
+        std::vector<double> floating_point;
+        std::vector<signed char> boolean;
+        std::vector<char> text;
+        std::vector<size_t> offsets;
+        std::vector<uint8_t> validity;
+      };
+    }
+
+    namespace
+    {
+      [[noreturn]] void throw_unsupported_binary_type(const char* target, Oid type)
+      {
+        throw sqlpp::exception("PostgreSQL error: cannot bind binary column of type " + std::to_string(type) + " as " +
+                               target);
+      }
+
+      int64_t decode_binary_integral(Oid type, const char* data)
+      {
+        switch (type)
+        {
+          case detail::oid::int2:
+            return static_cast<int16_t>(detail::read_uint16(data));
+          case detail::oid::int4:
+            return static_cast<int32_t>(detail::read_uint32(data));
+          case detail::oid::oid:
+            return detail::read_uint32(data);
+          case detail::oid::int8:
+            return static_cast<int64_t>(detail::read_uint64(data));
+          case detail::oid::boolean:
+            return *data != 0;
+          default:
+            throw_unsupported_binary_type("integral", type);
+        }
+      }
+
+      double decode_binary_floating_point(Oid type, const char* data)
+      {
+        switch (type)
+        {
+          case detail::oid::float4:
+            return detail::read_float4(data);
+          case detail::oid::float8:
+            return detail::read_float8(data);
+          case detail::oid::numeric:
+            return detail::read_numeric(data);
+          case detail::oid::int2:
+          case detail::oid::int4:
+          case detail::oid::int8:
+          case detail::oid::oid:
+            return static_cast<double>(decode_binary_integral(type, data));
+          default:
+            throw_unsupported_binary_type("floating_point", type);
+        }
+      }
+
+      // Parses a text format integer, the server sends them without whitespace or a plus sign.
+      int64_t parse_text_integral(const char* data)
+      {
+        const bool negative = *data == '-';
+        if (negative)
+        {
+          ++data;
+        }
+        uint64_t value = 0;
+        while (static_cast<unsigned>(*data - '0') < 10U)
+        {
+          value = value * 10 + static_cast<unsigned>(*data - '0');
+          ++data;
+        }
+        return static_cast<int64_t>(negative ? 0 - value : value);
+      }
+
+      value_view_t text_value(const PGresult* result, int row, int column)
+      {
+        const char* value = PQgetvalue(result, row, column);
+        size_t len = static_cast<size_t>(PQgetlength(result, row, column));
+
+        // The binary representation of the character types is the text itself
+        if (PQfformat(result, column) == 1)
+        {
+          const Oid type = PQftype(result, column);
+          if (type == detail::oid::jsonb)
+          {
+            // jsonb is prefixed with a one byte format version
+            if (len > 0)
+            {
+              ++value;
+              --len;
+            }
+          }
+          else if (!detail::is_text_type(type))
+          {
+            throw_unsupported_binary_type("text", type);
+          }
+        }
+        return {value, len};
+      }
+
+      void set_validity(std::vector<uint8_t>* validity, size_t row, bool valid)
+      {
+        if (!validity)
+        {
+          return;
+        }
+        if (validity->size() <= row / 8)
+        {
+          validity->resize(row / 8 + 1, 0);
+        }
+        if (valid)
+        {
+          (*validity)[row / 8] |= static_cast<uint8_t>(1U << (row % 8));
+        }
+        else
+        {
+          (*validity)[row / 8] &= static_cast<uint8_t>(~(1U << (row % 8)));
+        }
+      }
+
+      // Appends rows [first, last) of a column, the format and type are resolved
+      // once per batch so that the loop itself does not branch on them.
+      template <typename T, typename Decode>
+      void decode_rows(const PGresult* result,
+                       int column,
+                       int first,
+                       int last,
+                       std::vector<T>& values,
+                       std::vector<uint8_t>* validity,
+                       Decode decode)
+      {
+        size_t row = values.size();
+        values.reserve(row + static_cast<size_t>(last - first));
+        for (int r = first; r < last; ++r, ++row)
+        {
+          const bool is_null = PQgetisnull(result, r, column);
+          values.push_back(is_null ? T{} : decode(PQgetvalue(result, r, column)));
+          set_validity(validity, row, !is_null);
+        }
+      }
+
+      template <typename T>
+      void append_values(void* to, const void* from)
+      {
+        auto& values = *static_cast<std::vector<T>*>(to);
+        const auto& part = *static_cast<const std::vector<T>*>(from);
+        values.insert(values.end(), part.begin(), part.end());
+      }
+
+      // A run of rows of one batch, the pin keeps the batch alive until the rows are decoded
+      struct row_range_t
+      {
+        std::shared_ptr<PGresult> result;
+        int first;
+        int last;
+      };
+
+      struct decode_task_t
+      {
+        std::vector<row_range_t> ranges;
+        size_t rows{0};
+        std::vector<detail::column_part_t> parts;  // one per column
+      };
+
+      // The tasks to be decoded, every thread takes the next one as soon as it
+      // is done with its previous one. After a failure the tasks left are skipped.
+      class decode_queue_t
+      {
+        std::mutex _mutex;
+        std::condition_variable _ready;
+        std::list<decode_task_t*> _tasks;
+        bool _closed{false};
+        std::exception_ptr _error;
+
+      public:
+        void push(decode_task_t* task)
+        {
+          {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push_back(task);
+          }
+          _ready.notify_one();
+        }
+
+        //! no tasks follow
+        void close()
+        {
+          {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+          }
+          _ready.notify_all();
+        }
+
+        void fail(std::exception_ptr error)
+        {
+          {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error)
+            {
+              _error = error;
+            }
+            _tasks.clear();
+          }
+          _ready.notify_all();
+        }
+
+        //! the next task, nullptr once the queue is closed and empty or failed
+        decode_task_t* pop()
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _ready.wait(lock, [this]() { return !_tasks.empty() || _closed || _error; });
+          if (_error || _tasks.empty())
+          {
+            return nullptr;
+          }
+          decode_task_t* task = _tasks.front();
+          _tasks.pop_front();
+          return task;
+        }
+
+        void rethrow()
+        {
+          if (_error)
+          {
+            std::rethrow_exception(_error);
+          }
+        }
+      };
+
+      // Replaces the current result with the next batch of rows, returns false if there is none.
+      bool fetch_next_cursor_batch(detail::result_handle_t& handle)
+      {
+        if (handle.cursorExhausted)
+        {
+          return false;
+        }
+
+        if (handle.asyncPending && *handle.asyncPending)
+        {
+          throw sqlpp::exception("PostgreSQL error: an asynchronous statement is still pending");
+        }
+        if (handle.pipelineActive && *handle.pipelineActive)
+        {
+          throw sqlpp::exception("PostgreSQL error: a pipeline is open on the connection");
+        }
+        handle.finish_connection_stream();
+        handle.release_result();
+        handle.count = 0;
+        handle.totalCount = 0;
+        std::string cmd = "FETCH FORWARD " + std::to_string(handle.fetchSize) + " FROM \"" + handle.cursor + "\"";
+        handle.result = PQexecParams(handle.connection, cmd.c_str(), 0, nullptr, nullptr, nullptr, nullptr,
+                                     handle.resultFormat);
+
+        ExecStatusType ret = PQresultStatus(handle.result);
+        if (ret != PGRES_TUPLES_OK)
+        {
+          handle.cursorExhausted = true;
+          throw sqlpp::exception("PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                                 std::string(PQresultErrorMessage(handle.result)));
+        }
+
+        // A short batch is the last one, no need for another round trip
+        const size_t rows = static_cast<size_t>(PQntuples(handle.result));
+        if (rows < handle.fetchSize)
+        {
+          handle.cursorExhausted = true;
+        }
+        return rows > 0;
+      }
+
+      bool fetch_next_stream_batch(detail::result_handle_t& handle)
+      {
+        if (!handle.streaming)
+        {
+          return false;
+        }
+
+        handle.release_result();
+        handle.count = 0;
+        handle.totalCount = 0;
+        handle.result = PQgetResult(handle.connection);
+        if (!handle.result)
+        {
+          handle.end_stream();
+          return false;
+        }
+
+        ExecStatusType ret = PQresultStatus(handle.result);
+        switch (ret)
+        {
+          case PGRES_SINGLE_TUPLE:
+#ifdef LIBPQ_HAS_CHUNK_MODE
+          case PGRES_TUPLES_CHUNK:
+#endif
+          case PGRES_TUPLES_OK:  // the final, empty result
+            return true;
+          default:
+          {
+            std::string errmsg = "PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                                 std::string(PQresultErrorMessage(handle.result));
+            handle.finish_streaming();
+            throw sqlpp::exception(errmsg);
+          }
+        }
+      }
+
+      bool fetch_next_batch(detail::result_handle_t& handle)
+      {
+        if (handle.mode == detail::fetch_mode_t::materialized)
+        {
+          return false;
+        }
+
+        auto* instrumentation = detail::instrumentation(handle.instrumentation);
+        const auto start = detail::start_timer(instrumentation);
+        const bool fetched = handle.mode == detail::fetch_mode_t::cursor ? fetch_next_cursor_batch(handle)
+                                                                        : fetch_next_stream_batch(handle);
+        if (instrumentation && fetched)
+        {
+          instrumentation->on_fetch(detail::elapsed_since(start), static_cast<size_t>(PQntuples(handle.result)),
+                                    detail::result_bytes(handle.result));
+        }
+        return fetched;
+      }
+    }
+
+    bind_result_t::bind_result_t() = default;
+    bind_result_t::bind_result_t(bind_result_t&&) = default;
+    bind_result_t& bind_result_t::operator=(bind_result_t&&) = default;
+    bind_result_t::~bind_result_t() = default;
+
+    bind_result_t::bind_result_t(std::unique_ptr<detail::result_handle_t>&& handle) : _handle(std::move(handle))
     {
       if (this->_handle && this->_handle->debug)
       {
@@ -58,31 +404,38 @@ namespace sqlpp
         std::cerr << "PostgreSQL debug: accessing next row of handle at " << _handle.get() << std::endl;
       }
 
-      // Fetch total amount
-      if (_handle->totalCount == 0U)
+      while (true)
       {
-        _handle->totalCount = PQntuples(_handle->result);
+        // Fetch total amount of the current batch
         if (_handle->totalCount == 0U)
-          return false;
-      }
-      else
-      {
-        // Next row
-        if (_handle->count < (_handle->totalCount - 1))
         {
-          _handle->count++;
+          if (_handle->result)
+          {
+            _handle->totalCount = PQntuples(_handle->result);
+          }
+          if (_handle->totalCount != 0U)
+          {
+            break;
+          }
         }
         else
+        {
+          // Next row
+          if (_handle->count < (_handle->totalCount - 1))
+          {
+            _handle->count++;
+            return true;
+          }
+        }
+
+        if (!fetch_next_batch(*_handle))
         {
           return false;
         }
       }
 
-      // Really needed?
-      if (_handle->fields == 0U)
-      {
-        _handle->fields = PQnfields(_handle->result);
-      }
+      // A batch may be the first one to carry the row description
+      _handle->fields = PQnfields(_handle->result);
 
       return true;
     }
@@ -99,9 +452,27 @@ namespace sqlpp
       }
 
       // Assign value
-      std::istringstream in(PQgetvalue(_handle->result, _handle->count, index));
-      in >> *value;
       *is_null = PQgetisnull(_handle->result, _handle->count, index);
+      if (*is_null)
+      {
+        *value = false;
+        return;
+      }
+
+      const char* data = PQgetvalue(_handle->result, _handle->count, index);
+      if (PQfformat(_handle->result, index) == 1)
+      {
+        if (PQftype(_handle->result, index) != detail::oid::boolean)
+        {
+          throw_unsupported_binary_type("boolean", PQftype(_handle->result, index));
+        }
+        *value = *data != 0;
+      }
+      else
+      {
+        // Text format booleans are sent as 't' or 'f'
+        *value = (*data == 't' || *data == '1');
+      }
     }
 
     void bind_result_t::_bind_floating_point_result(size_t index, double* value, bool* is_null)
@@ -115,9 +486,21 @@ namespace sqlpp
         throw sqlpp::exception("PostgreSQL error: index out of range");
       }
 
-      std::istringstream in(PQgetvalue(_handle->result, _handle->count, index));
-      in >> *value;
       *is_null = PQgetisnull(_handle->result, _handle->count, index);
+      if (*is_null)
+      {
+        *value = 0;
+        return;
+      }
+
+      if (PQfformat(_handle->result, index) == 1)
+      {
+        *value = decode_binary_floating_point(PQftype(_handle->result, index),
+                                                        PQgetvalue(_handle->result, _handle->count, index));
+        return;
+      }
+
+      *value = detail::parse_double(PQgetvalue(_handle->result, _handle->count, index));
     }
 
     void bind_result_t::_bind_integral_result(size_t index, int64_t* value, bool* is_null)
@@ -131,9 +514,21 @@ namespace sqlpp
         throw sqlpp::exception("PostgreSQL error: index out of range");
       }
 
-      std::istringstream in(PQgetvalue(_handle->result, _handle->count, index));
-      in >> *value;
       *is_null = PQgetisnull(_handle->result, _handle->count, index);
+      if (*is_null)
+      {
+        *value = 0;
+        return;
+      }
+
+      if (PQfformat(_handle->result, index) == 1)
+      {
+        *value = decode_binary_integral(PQftype(_handle->result, index),
+                                                  PQgetvalue(_handle->result, _handle->count, index));
+        return;
+      }
+
+      *value = parse_text_integral(PQgetvalue(_handle->result, _handle->count, index));
     }
 
     void bind_result_t::_bind_text_result(size_t index, const char** value, size_t* len)
@@ -142,13 +537,412 @@ namespace sqlpp
       {
         std::cerr << "PostgreSQL debug: binding text result at index: " << index << std::endl;
       }
-      if (index > _handle->fields)
+
+      const value_view_t text = this->text(index);
+      *value = text.data();
+      *len = text.size();
+    }
+
+    void bind_result_t::check_column(size_t index) const
+    {
+      if (!_handle || !_handle->result || index >= _handle->fields)
       {
         throw sqlpp::exception("PostgreSQL error: index out of range");
       }
+    }
+
+    bool bind_result_t::is_null(size_t index) const
+    {
+      check_column(index);
+      return PQgetisnull(_handle->result, _handle->count, index);
+    }
+
+    value_view_t bind_result_t::text(size_t index) const
+    {
+      check_column(index);
+      return text_value(_handle->result, _handle->count, index);
+    }
+
+    value_view_t bind_result_t::bytea(size_t index) const
+    {
+      check_column(index);
+      if (PQfformat(_handle->result, index) != 1)
+      {
+        throw sqlpp::exception("PostgreSQL error: bytea views require binary results");
+      }
+      const Oid type = PQftype(_handle->result, index);
+      if (type != detail::oid::bytea)
+      {
+        throw_unsupported_binary_type("bytea", type);
+      }
+
+      // In the binary format a bytea is its bytes as they are, no unescaping needed
+      return {PQgetvalue(_handle->result, _handle->count, index),
+              static_cast<size_t>(PQgetlength(_handle->result, _handle->count, index))};
+    }
+
+    value_view_t bind_result_t::raw(size_t index) const
+    {
+      check_column(index);
+      return raw_unchecked(index);
+    }
+
+    value_view_t bind_result_t::raw_unchecked(size_t index) const
+    {
+      return {PQgetvalue(_handle->result, _handle->count, index),
+              static_cast<size_t>(PQgetlength(_handle->result, _handle->count, index))};
+    }
+
+    void bind_result_t::check_column_type(size_t index, unsigned int oid, wire_format_t format) const
+    {
+      check_column(index);
+      const Oid type = PQftype(_handle->result, index);
+      const wire_format_t actual = PQfformat(_handle->result, index) == 1 ? wire_format_t::binary : wire_format_t::text;
+      if (type != oid || actual != format)
+      {
+        throw sqlpp::exception("PostgreSQL error: column " + std::to_string(index) + " has type " +
+                               std::to_string(type) + (actual == wire_format_t::binary ? " (binary)" : " (text)") +
+                               ", expected " + std::to_string(oid) +
+                               (format == wire_format_t::binary ? " (binary)" : " (text)"));
+      }
+    }
+
+    result_pin_t bind_result_t::pin() const
+    {
+      if (!_handle)
+      {
+        return {};
+      }
+      return result_pin_t{_handle->pin_result()};
+    }
+
+    void bind_result_t::decode_column(const PGresult* result, const column_buffer_t& column, int first_row, int rows)
+    {
+      const int index = static_cast<int>(column._index);
+      const bool binary = PQfformat(result, index) == 1;
+      const Oid type = PQftype(result, index);
+
+      switch (column._type)
+      {
+        case column_buffer_t::type_t::integral:
+        {
+          auto& values = *static_cast<std::vector<int64_t>*>(column._values);
+          if (binary)
+          {
+            decode_rows(result, index, first_row, rows, values, column._validity,
+                        [type](const char* data) { return decode_binary_integral(type, data); });
+          }
+          else
+          {
+            decode_rows(result, index, first_row, rows, values, column._validity, parse_text_integral);
+          }
+          break;
+        }
+        case column_buffer_t::type_t::floating_point:
+        {
+          auto& values = *static_cast<std::vector<double>*>(column._values);
+          if (binary)
+          {
+            decode_rows(result, index, first_row, rows, values, column._validity,
+                        [type](const char* data) { return decode_binary_floating_point(type, data); });
+          }
+          else
+          {
+            decode_rows(result, index, first_row, rows, values, column._validity,
+                        [](const char* data) { return detail::parse_double(data); });
+          }
+          break;
+        }
+        case column_buffer_t::type_t::boolean:
+        {
+          auto& values = *static_cast<std::vector<signed char>*>(column._values);
+          if (binary && type != detail::oid::boolean)
+          {
+            throw_unsupported_binary_type("boolean", type);
+          }
+          // Binary booleans are 0 or 1, text booleans 't' or 'f'
+          decode_rows(result, index, first_row, rows, values, column._validity, [](const char* data) {
+            return static_cast<signed char>(*data == 1 || *data == 't' || *data == '1');
+          });
+          break;
+        }
+        case column_buffer_t::type_t::text:
+        {
+          auto& data = *static_cast<std::vector<char>*>(column._values);
+          auto& offsets = *column._offsets;
+          if (offsets.empty())
+          {
+            offsets.push_back(data.size());
+          }
+          size_t row = offsets.size() - 1;
+          offsets.reserve(offsets.size() + static_cast<size_t>(rows - first_row));
+          for (int r = first_row; r < rows; ++r, ++row)
+          {
+            const bool is_null = PQgetisnull(result, r, index);
+            if (!is_null)
+            {
+              const value_view_t value = text_value(result, r, index);
+              data.insert(data.end(), value.begin(), value.end());
+            }
+            offsets.push_back(data.size());
+            set_validity(column._validity, row, !is_null);
+          }
+          break;
+        }
+      }
+    }
+
+    size_t bind_result_t::fetch_columns(const std::vector<column_buffer_t>& columns)
+    {
+      if (!_handle)
+      {
+        return 0;
+      }
+      if (_handle->debug)
+      {
+        std::cerr << "PostgreSQL debug: fetching columns of handle at " << _handle.get() << std::endl;
+      }
+
+      // Rows up to and including the current one have been visited by next() already
+      int first_row = _handle->totalCount == 0U ? 0 : static_cast<int>(_handle->count) + 1;
+      size_t total = 0;
+      while (true)
+      {
+        if (_handle->result)
+        {
+          const int rows = PQntuples(_handle->result);
+          if (first_row < rows)
+          {
+            _handle->fields = PQnfields(_handle->result);
+            // Validate every index first, so that a bad one leaves the buffers untouched
+            for (const auto& column : columns)
+            {
+              check_column(column._index);
+            }
+            for (const auto& column : columns)
+            {
+              decode_column(_handle->result, column, first_row, rows);
+            }
+            total += static_cast<size_t>(rows - first_row);
+          }
+
+          // Leave the batch as if next() had visited all of its rows
+          _handle->totalCount = static_cast<uint32_t>(rows);
+          _handle->count = rows > 0 ? static_cast<uint32_t>(rows - 1) : 0U;
+        }
+
+        if (!fetch_next_batch(*_handle))
+        {
+          break;
+        }
+        first_row = 0;
+      }
+      return total;
+    }
+
+    column_buffer_t bind_result_t::part_buffer(const column_buffer_t& column, detail::column_part_t& part)
+    {
+      std::vector<uint8_t>* validity = column._validity ? &part.validity : nullptr;
+      switch (column._type)
+      {
+        case column_buffer_t::type_t::integral:
+          return column_buffer_t(column._index, part.integral, validity);
+        case column_buffer_t::type_t::floating_point:
+          return column_buffer_t(column._index, part.floating_point, validity);
+        case column_buffer_t::type_t::boolean:
+          return column_buffer_t(column._index, part.boolean, validity);
+        case column_buffer_t::type_t::text:
+        default:
+          return column_buffer_t(column._index, part.text, part.offsets, validity);
+      }
+    }
+
+    void bind_result_t::merge_part(const column_buffer_t& column, const column_buffer_t& part)
+    {
+      size_t row = 0;
+      size_t rows = 0;
+      switch (column._type)
+      {
+        case column_buffer_t::type_t::integral:
+          row = static_cast<std::vector<int64_t>*>(column._values)->size();
+          rows = static_cast<std::vector<int64_t>*>(part._values)->size();
+          append_values<int64_t>(column._values, part._values);
+          break;
+        case column_buffer_t::type_t::floating_point:
+          row = static_cast<std::vector<double>*>(column._values)->size();
+          rows = static_cast<std::vector<double>*>(part._values)->size();
+          append_values<double>(column._values, part._values);
+          break;
+        case column_buffer_t::type_t::boolean:
+          row = static_cast<std::vector<signed char>*>(column._values)->size();
+          rows = static_cast<std::vector<signed char>*>(part._values)->size();
+          append_values<signed char>(column._values, part._values);
+          break;
+        case column_buffer_t::type_t::text:
+        {
+          auto& data = *static_cast<std::vector<char>*>(column._values);
+          auto& offsets = *column._offsets;
+          const auto& partData = *static_cast<const std::vector<char>*>(part._values);
+          const auto& partOffsets = *part._offsets;
+          if (partOffsets.empty())
+          {
+            return;
+          }
+          if (offsets.empty())
+          {
+            offsets.push_back(data.size());
+          }
+          row = offsets.size() - 1;
+          rows = partOffsets.size() - 1;
+          // The part's offsets start at 0, shift them behind the data already present
+          const size_t base = data.size() - partOffsets.front();
+          data.insert(data.end(), partData.begin(), partData.end());
+          offsets.reserve(offsets.size() + rows);
+          for (size_t i = 1; i < partOffsets.size(); ++i)
+          {
+            offsets.push_back(base + partOffsets[i]);
+          }
+          break;
+        }
+      }
+
+      if (column._validity)
+      {
+        const auto& validity = *part._validity;
+        for (size_t i = 0; i < rows; ++i)
+        {
+          set_validity(column._validity, row + i, (validity[i / 8] >> (i % 8)) & 1U);
+        }
+      }
+    }
 
-      *value = const_cast<const char*>(PQgetvalue(_handle->result, _handle->count, index));
-      *len = PQgetlength(_handle->result, _handle->count, index);
+    size_t bind_result_t::fetch_columns_parallel(const std::vector<column_buffer_t>& columns,
+                                                 size_t threads,
+                                                 size_t task_rows)
+    {
+      if (!_handle)
+      {
+        return 0;
+      }
+      if (threads == 0)
+      {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+      }
+      task_rows = std::max<size_t>(task_rows, 1);
+      if (_handle->debug)
+      {
+        std::cerr << "PostgreSQL debug: fetching columns of handle at " << _handle.get() << " on " << threads
+                  << " threads" << std::endl;
+      }
+
+      std::list<decode_task_t> tasks;
+      decode_queue_t queue;
+      auto work = [&queue, &columns]() {
+        while (decode_task_t* task = queue.pop())
+        {
+          try
+          {
+            task->parts.resize(columns.size());
+            for (const auto& range : task->ranges)
+            {
+              for (size_t i = 0; i < columns.size(); ++i)
+              {
+                decode_column(range.result.get(), part_buffer(columns[i], task->parts[i]), range.first, range.last);
+              }
+            }
+            // Batches are freed as soon as their rows are decoded
+            task->ranges.clear();
+          }
+          catch (...)
+          {
+            queue.fail(std::current_exception());
+          }
+        }
+      };
+
+      // This thread receives the batches and splits them into tasks, then helps decoding
+      std::vector<std::thread> workers;
+      size_t total = 0;
+      try
+      {
+        for (size_t i = 1; i < threads; ++i)
+        {
+          workers.emplace_back(work);
+        }
+
+        // Rows up to and including the current one have been visited by next() already
+        int first_row = _handle->totalCount == 0U ? 0 : static_cast<int>(_handle->count) + 1;
+        decode_task_t* task = nullptr;
+        while (true)
+        {
+          if (_handle->result)
+          {
+            const int rows = PQntuples(_handle->result);
+            if (first_row < rows)
+            {
+              _handle->fields = PQnfields(_handle->result);
+              for (const auto& column : columns)
+              {
+                check_column(column._index);
+              }
+              const std::shared_ptr<PGresult> batch = _handle->pin_result();
+              while (first_row < rows)
+              {
+                if (!task)
+                {
+                  tasks.emplace_back();
+                  task = &tasks.back();
+                }
+                const int last = first_row + static_cast<int>(std::min(static_cast<size_t>(rows - first_row),
+                                                                       task_rows - task->rows));
+                task->ranges.push_back({batch, first_row, last});
+                task->rows += static_cast<size_t>(last - first_row);
+                total += static_cast<size_t>(last - first_row);
+                first_row = last;
+                if (task->rows == task_rows)
+                {
+                  queue.push(task);
+                  task = nullptr;
+                }
+              }
+            }
+
+            // Leave the batch as if next() had visited all of its rows
+            _handle->totalCount = static_cast<uint32_t>(rows);
+            _handle->count = rows > 0 ? static_cast<uint32_t>(rows - 1) : 0U;
+          }
+
+          if (!fetch_next_batch(*_handle))
+          {
+            break;
+          }
+          first_row = 0;
+        }
+        if (task)
+        {
+          queue.push(task);
+        }
+      }
+      catch (...)
+      {
+        queue.fail(std::current_exception());
+      }
+      queue.close();
+      work();
+      for (auto& worker : workers)
+      {
+        worker.join();
+      }
+      queue.rethrow();
+
+      for (auto& task : tasks)
+      {
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+          merge_part(columns[i], part_buffer(columns[i], task.parts[i]));
+        }
+      }
+      return total;
     }
   }
 }
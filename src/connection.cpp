@@ -30,10 +30,12 @@
 
 #include <algorithm>
 #include <iostream>
-#include <random>
+#include <iterator>
 
 #include "detail/prepared_statement_handle.h"
 #include "detail/connection_handle.h"
+#include "detail/instrumentation.h"
+#include "detail/socket.h"
 
 namespace sqlpp
 {
@@ -41,279 +43,1327 @@ namespace sqlpp
   {
     namespace
     {
-      detail::prepared_statement_handle_t prepare_statement(detail::connection_handle& handle,
-                                                            const std::string& stmt,
-                                                            const size_t& paramCount)
+      // Anything sent while an asynchronous statement is in flight would make libpq discard its result,
+      // and while a pipeline is open it would be mixed up with the pipeline's statements
+      void check_idle(const detail::connection_handle& handle)
       {
+        if (handle.async_pending)
+        {
+          throw sqlpp::exception("PostgreSQL error: an asynchronous statement is still pending");
+        }
+        if (handle.pipeline_active)
+        {
+          throw sqlpp::exception("PostgreSQL error: a pipeline is open on the connection");
+        }
+      }
+
+      // A streamed result whose rows are still arriving blocks the connection, so
+      // executing anything else abandons it, like re-executing its statement does.
+      void finish_active_stream(detail::connection_handle& handle)
+      {
+        if (handle.active_stream)
+        {
+          handle.active_stream->finish_streaming();
+        }
+      }
+
+      std::shared_ptr<detail::prepared_statement_handle_t> prepare_statement(detail::connection_handle& handle,
+                                                                             const std::string& stmt,
+                                                                             const size_t& paramCount)
+      {
+        check_idle(handle);
         if (handle.config->debug)
         {
           std::cerr << "PostgreSQL debug: preparing: " << stmt << std::endl;
         }
 
-        detail::prepared_statement_handle_t result(handle.postgres, paramCount, handle.config->debug);
+        auto* instrumentation = detail::instrumentation(handle.config->instrumentation);
+        const auto start = detail::start_timer(instrumentation);
+        auto result =
+            std::make_shared<detail::prepared_statement_handle_t>(handle.postgres, paramCount, handle.config->debug);
+
+        // Reuse the server side statement if the same SQL has been prepared before
+        result->statement = handle.statement_cache.find(stmt);
+        if (result->statement)
+        {
+          if (handle.config->debug)
+          {
+            std::cerr << "PostgreSQL debug: reusing cached statement " << result->statement->name << std::endl;
+          }
+          result->valid = true;
+          result->paramTypes = result->statement->param_types;
+          if (instrumentation)
+          {
+            instrumentation->on_prepare(stmt, detail::elapsed_since(start), true);
+          }
+          return result;
+        }
+
+        // Create the prepared statement
+        finish_active_stream(handle);
+        std::string name = handle.next_statement_name();
+        PGresult* res = PQprepare(handle.postgres, name.c_str(), stmt.c_str(), 0, nullptr);
+        std::string errmsg = "PostgreSQL error: ";
+        ExecStatusType ret = PQresultStatus(res);
+        std::string rerrmsg(PQresultErrorMessage(res));
+        PQclear(res);
+        switch (ret)
+        {
+          case PGRES_EMPTY_QUERY:
+          case PGRES_COPY_OUT:
+          case PGRES_COPY_IN:
+          case PGRES_BAD_RESPONSE:
+          case PGRES_NONFATAL_ERROR:
+          case PGRES_FATAL_ERROR:
+          case PGRES_COPY_BOTH:
+            errmsg.append(std::string(PQresStatus(ret)) + std::string(": ") + rerrmsg);
+            throw sqlpp::exception(errmsg);
+          case PGRES_COMMAND_OK:
+          case PGRES_TUPLES_OK:
+          case PGRES_SINGLE_TUPLE:
+          default:
+            result->valid = true;
+            break;
+        }
+
+        result->statement = std::make_shared<detail::server_statement_t>(handle, std::move(name), stmt);
+
+        // Binary parameters have to match the parameter types the server inferred
+        if (handle.config->binary_parameters && paramCount > 0)
+        {
+          res = PQdescribePrepared(handle.postgres, result->statement->name.c_str());
+          if (PQresultStatus(res) == PGRES_COMMAND_OK)
+          {
+            for (int i = 0; i < PQnparams(res); ++i)
+            {
+              result->statement->param_types.push_back(PQparamtype(res, i));
+            }
+          }
+          PQclear(res);
+          result->paramTypes = result->statement->param_types;
+        }
+
+        handle.statement_cache.insert(stmt, result->statement);
+        if (instrumentation)
+        {
+          instrumentation->on_prepare(stmt, detail::elapsed_since(start), false);
+        }
+        return result;
+      }
+
+      // Whether the server has a transaction block open, possibly an aborted one. Meaningful while the
+      // connection is idle, PQtransactionStatus() reports active during a statement.
+      bool server_transaction(const detail::connection_handle& handle)
+      {
+        const PGTransactionStatusType status = PQtransactionStatus(handle.postgres);
+        return status == PQTRANS_INTRANS || status == PQTRANS_INERROR;
+      }
+
+      // A deferred BEGIN fails along with the commands sent with it, leaving the
+      // caller's transaction without a transaction block on the server. Later
+      // statements would run in autocommit, so they throw until it is rolled back.
+      void check_deferred_begin(detail::connection_handle& handle, bool begin_deferred)
+      {
+        if (begin_deferred && !server_transaction(handle))
+        {
+          handle.transaction_failed = true;
+        }
+      }
+
+      // Whether the next statement runs in a transaction block, including one whose BEGIN is still deferred
+      bool in_transaction_block(const detail::connection_handle& handle)
+      {
+        return handle.begin_deferred || server_transaction(handle);
+      }
+
+      void check_transaction(const detail::connection_handle& handle)
+      {
+        if (handle.transaction_failed)
+        {
+          throw sqlpp::exception("PostgreSQL error: the transaction failed and must be rolled back");
+        }
+      }
+
+      // Sends the deferred commands on their own, in one simple query, for the
+      // operations that cannot share a round trip with them (streaming, COPY,
+      // asynchronous statements and pipelines).
+      void send_prologue(detail::connection_handle& handle)
+      {
+        if (handle.prologue.empty())
+        {
+          return;
+        }
+        check_idle(handle);
+        finish_active_stream(handle);
+        std::string commands;
+        for (const auto& command : handle.prologue)
+        {
+          commands.append(commands.empty() ? "" : "; ").append(command);
+        }
+        handle.prologue.clear();
+        const bool begin_deferred = handle.begin_deferred;
+        handle.begin_deferred = false;
+        if (handle.config->debug)
+        {
+          std::cerr << "PostgreSQL debug: executing: " << commands << std::endl;
+        }
+
+        PGresult* res = PQexec(handle.postgres, commands.c_str());
+        ExecStatusType ret = PQresultStatus(res);
+        if (ret != PGRES_COMMAND_OK)
+        {
+          std::string errmsg = "PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                               std::string(PQresultErrorMessage(res));
+          PQclear(res);
+          handle.session_timeout = -1;
+          check_deferred_begin(handle, begin_deferred);
+          throw sqlpp::exception(errmsg);
+        }
+        PQclear(res);
+      }
+
+      // Folds a change of the statement timeout into the deferred commands. The
+      // timeout is set for the session rather than with SET LOCAL, which has no
+      // effect outside of transactions, and only sent again once it changed.
+      void queue_timeout(detail::connection_handle& handle)
+      {
+        const int64_t timeout = handle.statement_timeout.count();
+        if (timeout == handle.session_timeout)
+        {
+          return;
+        }
+        handle.prologue.push_back(timeout > 0 ? "SET statement_timeout = " + std::to_string(timeout)
+                                              : std::string("RESET statement_timeout"));
+        handle.session_timeout = timeout;
+      }
+
+      // Folds the DEALLOCATEs of the statements destroyed since into the deferred
+      // commands. In an aborted transaction they would fail, they wait for its end.
+      void queue_deallocations(detail::connection_handle& handle)
+      {
+        if (handle.deallocations.empty() || PQtransactionStatus(handle.postgres) == PQTRANS_INERROR)
+        {
+          return;
+        }
+        handle.prologue.insert(handle.prologue.end(), handle.deallocations.begin(), handle.deallocations.end());
+        handle.deallocations.clear();
+      }
+
+      // Asks the server to cancel the statement in progress, the statement then
+      // fails unless it completed in the meantime. PQcancel opens a connection of
+      // its own and may be called from any thread.
+      bool request_cancel(detail::connection_handle& handle)
+      {
+        char error[256] = "not connected";
+        if (!handle.cancel_token || !PQcancel(handle.cancel_token, error, sizeof(error)))
+        {
+          if (handle.config->debug)
+          {
+            std::cerr << "PostgreSQL debug: cancel request failed: " << error << std::endl;
+          }
+          return false;
+        }
+        return true;
+      }
+
+      // Returns the next result like PQgetResult, waiting for it no longer than
+      // until the deadline. Then the statements in progress are cancelled and
+      // their results, which follow soon after, are awaited without a deadline.
+      PGresult* next_result(detail::connection_handle& handle,
+                            detail::connection_handle::clock_t::time_point deadline,
+                            bool& cancelled)
+      {
+        while (PQisBusy(handle.postgres))
+        {
+          const int timeout_ms = cancelled ? -1 : detail::connection_handle::timeout_until(deadline);
+          if (!detail::wait_socket(handle.postgres, true, false, timeout_ms))
+          {
+            if (handle.config->debug)
+            {
+              std::cerr << "PostgreSQL debug: statement timeout expired, cancelling" << std::endl;
+            }
+            cancelled = true;
+            request_cancel(handle);
+            continue;
+          }
+          if (!PQconsumeInput(handle.postgres))
+          {
+            break;  // PQgetResult reports the broken connection
+          }
+        }
+        return PQgetResult(handle.postgres);
+      }
+
+      // Sends the deferred commands and then the statement issued by send(), a
+      // call to one of the PQsend* functions, and returns the statement's result.
+      // In a transaction block they go out in pipeline mode, in one message and a
+      // single round trip; if a command fails the server skips the rest up to the
+      // sync point. Outside of one the pipeline would run them in an implicit
+      // transaction block, which some statements (VACUUM, CREATE DATABASE) refuse,
+      // so the deferred commands are sent on their own first.
+      // The statement is cancelled if it exceeds timeout, 0 for none.
+      template <typename Send>
+      PGresult* exec_sent(detail::connection_handle& handle, std::chrono::milliseconds timeout, Send send)
+      {
+        PGconn* conn = handle.postgres;
+        const auto deadline = timeout.count() > 0 ? detail::connection_handle::clock_t::now() + timeout
+                                                  : detail::connection_handle::clock_t::time_point::max();
+        bool cancelled = false;
+        std::string errmsg;
+        PGresult* result = nullptr;
+        const bool begin_deferred = handle.begin_deferred;
+#ifdef LIBPQ_HAS_PIPELINING
+        if (!handle.prologue.empty() && in_transaction_block(handle))
+        {
+          const std::vector<std::string> prologue = std::move(handle.prologue);
+          handle.prologue.clear();
+          handle.begin_deferred = false;
+
+          bool sent = PQenterPipelineMode(conn);
+          for (const auto& command : prologue)
+          {
+            if (handle.config->debug)
+            {
+              std::cerr << "PostgreSQL debug: executing with the statement: " << command << std::endl;
+            }
+            sent = sent && PQsendQueryParams(conn, command.c_str(), 0, nullptr, nullptr, nullptr, nullptr, 0);
+          }
+          if (!sent || !send() || !PQpipelineSync(conn))
+          {
+            const std::string error = PQerrorMessage(conn);
+            PQexitPipelineMode(conn);
+            handle.session_timeout = -1;
+            check_deferred_begin(handle, begin_deferred);
+            throw sqlpp::exception("PostgreSQL error: " + error);
+          }
+
+          for (size_t i = 0; i < prologue.size(); ++i)
+          {
+            PGresult* res = next_result(handle, deadline, cancelled);
+            ExecStatusType ret = PQresultStatus(res);
+            if (errmsg.empty() && ret != PGRES_COMMAND_OK)
+            {
+              errmsg = "PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                       std::string(PQresultErrorMessage(res));
+            }
+            PQclear(res);
+            next_result(handle, deadline, cancelled);  // end of the command's results, always nullptr
+          }
+          result = next_result(handle, deadline, cancelled);
+          while (PGresult* extra = next_result(handle, deadline, cancelled))
+          {
+            PQclear(extra);
+          }
+          PQclear(next_result(handle, deadline, cancelled));  // the sync point
+          PQexitPipelineMode(conn);
+        }
+        else
+#endif
+        {
+          send_prologue(handle);
+          if (!send())
+          {
+            throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(conn)));
+          }
+          while (PGresult* next = next_result(handle, deadline, cancelled))
+          {
+            PQclear(result);
+            result = next;
+          }
+        }
+
+        // A failed statement rolls back the implicit transaction it shared with the commands
+        const bool failed = !errmsg.empty() || PQresultStatus(result) == PGRES_FATAL_ERROR;
+        if (failed)
+        {
+          handle.session_timeout = -1;
+          check_deferred_begin(handle, begin_deferred);
+        }
+        if (failed && cancelled)
+        {
+          PQclear(result);
+          throw sqlpp::exception("PostgreSQL error: statement cancelled after exceeding its timeout of " +
+                                 std::to_string(timeout.count()) + " ms");
+        }
+        if (!errmsg.empty())
+        {
+          PQclear(result);
+          throw sqlpp::exception(errmsg);
+        }
+        return result;
+      }
+
+      using savepoint_list_t = std::vector<std::pair<std::string, uint64_t>>;
+
+      // The savepoint created last with that name, it shadows earlier ones of the same name
+      savepoint_list_t::iterator find_savepoint(detail::connection_handle& handle, const std::string& name)
+      {
+        auto& savepoints = handle.savepoints;
+        const auto found = std::find_if(savepoints.rbegin(), savepoints.rend(),
+                                        [&name](const savepoint_list_t::value_type& s) { return s.first == name; });
+        return found == savepoints.rend() ? savepoints.end() : std::prev(found.base());
+      }
+
+      std::string quote_identifier(const std::string& name)
+      {
+        std::string quoted = "\"";
+        for (const char c : name)
+        {
+          quoted.append(c == '"' ? 2 : 1, c);
+        }
+        return quoted + "\"";
+      }
+
+      // Hands the notifications libpq has queued to the subscribers of their channels
+      size_t deliver_notifications(detail::connection_handle& handle)
+      {
+        size_t count = 0;
+        while (PGnotify* received = PQnotifies(handle.postgres))
+        {
+          notification_t notification;
+          notification.channel = received->relname;
+          notification.payload = received->extra ? received->extra : "";
+          notification.backend_pid = received->be_pid;
+          PQfreemem(received);
+          ++count;
+          if (handle.config->debug)
+          {
+            std::cerr << "PostgreSQL debug: notification on " << notification.channel << std::endl;
+          }
+
+          // Callbacks may subscribe or unsubscribe, so collect them first
+          std::vector<notification_callback_t> callbacks;
+          for (const auto& subscription : handle.subscriptions)
+          {
+            if (subscription.second.first == notification.channel)
+            {
+              callbacks.push_back(subscription.second.second);
+            }
+          }
+          for (const auto& callback : callbacks)
+          {
+            callback(notification);
+          }
+        }
+        return count;
+      }
+
+      void execute_statement(detail::connection_handle& handle, detail::prepared_statement_handle_t& prepared)
+      {
+        // Execute prepared statement with the parameters.
+        check_idle(handle);
+        finish_active_stream(handle);
+        prepared.mode = detail::fetch_mode_t::materialized;
+        prepared.release_result();
+        prepared.count = 0;
+        prepared.totalCount = 0;
+        auto* instrumentation = detail::instrumentation(handle.config->instrumentation);
+        const auto start = detail::start_timer(instrumentation);
+        try
+        {
+          const int resultFormat = handle.config->binary_results ? 1 : 0;
+          check_transaction(handle);
+          queue_timeout(handle);
+          queue_deallocations(handle);
+          if (handle.prologue.empty() && handle.statement_timeout.count() == 0)
+          {
+            prepared.result = PQexecPrepared(handle.postgres, prepared.statement->name.c_str(), prepared.param_count(),
+                                             prepared.param_values(), prepared.paramLengths.data(),
+                                             prepared.paramFormats.data(), resultFormat);
+          }
+          else
+          {
+            prepared.result = exec_sent(handle, handle.statement_timeout, [&]() {
+              return PQsendQueryPrepared(handle.postgres, prepared.statement->name.c_str(), prepared.param_count(),
+                                         prepared.param_values(), prepared.paramLengths.data(),
+                                         prepared.paramFormats.data(), resultFormat);
+            });
+          }
+
+          // check statement
+          std::string errmsg = "PostgreSQL error: ";
+          ExecStatusType ret = PQresultStatus(prepared.result);
+          switch (ret)
+          {
+            case PGRES_EMPTY_QUERY:
+            case PGRES_COPY_OUT:
+            case PGRES_COPY_IN:
+            case PGRES_BAD_RESPONSE:
+            case PGRES_NONFATAL_ERROR:
+            case PGRES_FATAL_ERROR:
+            case PGRES_COPY_BOTH:
+              prepared.valid = false;
+              errmsg.append(std::string(PQresStatus(ret)) + std::string(": ") +
+                            std::string(PQresultErrorMessage(prepared.result)));
+              throw sqlpp::exception(errmsg);
+            case PGRES_COMMAND_OK:
+            case PGRES_TUPLES_OK:
+            case PGRES_SINGLE_TUPLE:
+            default:
+              prepared.valid = true;
+              break;
+          }
+        }
+        catch (const std::exception& e)
+        {
+          if (instrumentation)
+          {
+            instrumentation->on_execute_failed(prepared.statement->sql, detail::elapsed_since(start), e.what());
+          }
+          throw;
+        }
+
+        if (instrumentation)
+        {
+          instrumentation->on_execute(prepared.statement->sql, detail::elapsed_since(start),
+                                      detail::result_rows(prepared.result), detail::result_bytes(prepared.result));
+        }
+      }
+
+      // Execute a statement without creating a named prepared statement. The
+      // statement is sent through PQexecParams, so it is parsed into the unnamed
+      // statement and no DEALLOCATE is required afterwards. COMMIT and ROLLBACK
+      // are sent as transaction_control: without a statement timeout, as a SET
+      // ahead of them would fail in an aborted transaction and take them along.
+      std::shared_ptr<detail::prepared_statement_handle_t> execute_direct(detail::connection_handle& handle,
+                                                                          const std::string& stmt,
+                                                                          bool transaction_control = false)
+      {
+        check_idle(handle);
+        if (handle.config->debug)
+        {
+          std::cerr << "PostgreSQL debug: executing: " << stmt << std::endl;
+        }
+
+        auto* instrumentation = detail::instrumentation(handle.config->instrumentation);
+        const auto start = detail::start_timer(instrumentation);
+        finish_active_stream(handle);
+        auto direct = std::make_shared<detail::prepared_statement_handle_t>(handle.postgres, 0, handle.config->debug);
+        try
+        {
+          const int resultFormat = handle.config->binary_results ? 1 : 0;
+          const auto timeout = transaction_control ? std::chrono::milliseconds(0) : handle.statement_timeout;
+          if (!transaction_control)
+          {
+            check_transaction(handle);
+            queue_timeout(handle);
+            queue_deallocations(handle);
+          }
+          if (handle.prologue.empty() && timeout.count() == 0)
+          {
+            direct->result =
+                PQexecParams(handle.postgres, stmt.c_str(), 0, nullptr, nullptr, nullptr, nullptr, resultFormat);
+          }
+          else
+          {
+            direct->result = exec_sent(handle, timeout, [&]() {
+              return PQsendQueryParams(handle.postgres, stmt.c_str(), 0, nullptr, nullptr, nullptr, nullptr,
+                                       resultFormat);
+            });
+          }
+
+          // check statement
+          std::string errmsg = "PostgreSQL error: ";
+          ExecStatusType ret = PQresultStatus(direct->result);
+          switch (ret)
+          {
+            case PGRES_EMPTY_QUERY:
+            case PGRES_COPY_OUT:
+            case PGRES_COPY_IN:
+            case PGRES_BAD_RESPONSE:
+            case PGRES_NONFATAL_ERROR:
+            case PGRES_FATAL_ERROR:
+            case PGRES_COPY_BOTH:
+              errmsg.append(std::string(PQresStatus(ret)) + std::string(": ") +
+                            std::string(PQresultErrorMessage(direct->result)));
+              throw sqlpp::exception(errmsg);
+            case PGRES_COMMAND_OK:
+            case PGRES_TUPLES_OK:
+            case PGRES_SINGLE_TUPLE:
+            default:
+              direct->valid = true;
+              break;
+          }
+        }
+        catch (const std::exception& e)
+        {
+          if (instrumentation)
+          {
+            instrumentation->on_execute_failed(stmt, detail::elapsed_since(start), e.what());
+          }
+          throw;
+        }
+
+        if (instrumentation)
+        {
+          instrumentation->on_execute(stmt, detail::elapsed_since(start), detail::result_rows(direct->result),
+                                      detail::result_bytes(direct->result));
+        }
+        return direct;
+      }
+
+      // Sends the query without waiting for the result and switches to single row
+      // mode, or chunked mode if requested and supported, so that bind_result_t
+      // pulls the rows as they arrive instead of libpq buffering all of them.
+      void start_streaming(detail::connection_handle& handle,
+                           detail::prepared_statement_handle_t& prepared,
+                           const std::string* stmt,
+                           size_t chunk_rows)
+      {
+        check_idle(handle);
+        finish_active_stream(handle);
+        prepared.release_result();
+        prepared.count = 0;
+        prepared.totalCount = 0;
+        prepared.mode = detail::fetch_mode_t::streaming;
+        prepared.cancelOnAbandon = !in_transaction_block(handle);
+        prepared.instrumentation = handle.config->instrumentation;
+        auto* instrumentation = detail::instrumentation(prepared.instrumentation);
+        const auto start = detail::start_timer(instrumentation);
+
+        try
+        {
+          check_transaction(handle);
+          // Only the server enforces the timeout, the rows are pulled at the caller's pace
+          queue_timeout(handle);
+          queue_deallocations(handle);
+          send_prologue(handle);
+          const int resultFormat = handle.config->binary_results ? 1 : 0;
+          int sent;
+          if (stmt)
+          {
+            sent =
+                PQsendQueryParams(handle.postgres, stmt->c_str(), 0, nullptr, nullptr, nullptr, nullptr, resultFormat);
+          }
+          else
+          {
+            sent = PQsendQueryPrepared(handle.postgres, prepared.statement->name.c_str(), prepared.param_count(),
+                                       prepared.param_values(), prepared.paramLengths.data(),
+                                       prepared.paramFormats.data(), resultFormat);
+          }
+          if (!sent)
+          {
+            throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(handle.postgres)));
+          }
+          prepared.start_stream(&handle.active_stream);
+          prepared.valid = true;
+        }
+        catch (const std::exception& e)
+        {
+          if (instrumentation)
+          {
+            instrumentation->on_execute_failed(stmt ? *stmt : prepared.statement->sql, detail::elapsed_since(start),
+                                               e.what());
+          }
+          throw;
+        }
+
+        if (instrumentation)
+        {
+          instrumentation->on_execute(stmt ? *stmt : prepared.statement->sql, detail::elapsed_since(start), 0, 0);
+        }
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+        if (chunk_rows > 1)
+        {
+          PQsetChunkedRowsMode(handle.postgres, static_cast<int>(chunk_rows));
+          return;
+        }
+#else
+        (void)chunk_rows;
+#endif
+        PQsetSingleRowMode(handle.postgres);
+      }
+
+      size_t affected_rows(PGresult* result)
+      {
+        std::istringstream in(PQcmdTuples(result));
+        size_t rows = 0;
+        in >> rows;
+        return rows;
+      }
+    }
+
+    connection::connection(const std::shared_ptr<connection_config>& config)
+        : _handle(new detail::connection_handle(config))
+    {
+    }
+
+    connection::connection(std::unique_ptr<detail::connection_handle>&& handle) : _handle(std::move(handle))
+    {
+    }
+
+    connection::~connection()
+    {
+    }
+
+    std::vector<std::unique_ptr<connection>> connection::connect_parallel(
+        const std::shared_ptr<connection_config>& config,
+        size_t count)
+    {
+      std::vector<std::unique_ptr<detail::connection_handle>> pending;
+      for (size_t i = 0; i < count; ++i)
+      {
+        pending.emplace_back(new detail::connection_handle(config, detail::deferred_connect));
+      }
+
+      std::vector<std::unique_ptr<connection>> connected;
+      const auto deadline = pending.empty() ? detail::connection_handle::clock_t::time_point::max()
+                                            : pending.front()->connect_deadline();
+      std::vector<detail::pollfd_t> fds;
+      while (!pending.empty())
+      {
+        fds.clear();
+        for (const auto& handle : pending)
+        {
+          fds.push_back(detail::make_pollfd(handle->postgres, !handle->connect_wants_write(),
+                                            handle->connect_wants_write()));
+        }
+        const int ready = detail::poll_sockets(fds.data(), fds.size(),
+                                               detail::connection_handle::timeout_until(deadline));
+        if (ready < 0)
+        {
+          throw sqlpp::exception("PostgreSQL error: failed to connect to the database: poll failed");
+        }
+        if (ready == 0)
+        {
+          throw sqlpp::exception("PostgreSQL error: failed to connect to the database: timeout expired");
+        }
+
+        // Connections still pending are closed by their handles if one of them fails
+        for (size_t i = pending.size(); i-- > 0;)
+        {
+          if (fds[i].revents && pending[i]->connect_poll() == PGRES_POLLING_OK)
+          {
+            connected.emplace_back(new connection(std::move(pending[i])));
+            pending.erase(pending.begin() + static_cast<std::ptrdiff_t>(i));
+          }
+        }
+      }
+      return connected;
+    }
+
+    connection::connection(connection&& other)
+    {
+      this->_transaction_active = other._transaction_active;
+      this->_handle = std::move(other._handle);
+      this->_async_result = std::move(other._async_result);
+      this->_async_select = std::move(other._async_select);
+      this->_async_execute = std::move(other._async_execute);
+      this->_async_error = std::move(other._async_error);
+    }
+
+    // direct execution
+    bind_result_t connection::select_impl(const std::string& stmt)
+    {
+      return {execute_direct(*_handle, stmt)->take()};
+    }
+
+    bind_result_t connection::select_streaming_impl(const std::string& stmt, size_t chunk_rows)
+    {
+      if (_handle->config->debug)
+      {
+        std::cerr << "PostgreSQL debug: streaming: " << stmt << std::endl;
+      }
+
+      auto streamed =
+          std::make_shared<detail::prepared_statement_handle_t>(_handle->postgres, 0, _handle->config->debug);
+      start_streaming(*_handle, *streamed, &stmt, chunk_rows);
+      return {streamed->take()};
+    }
+
+    bind_result_t connection::select_cursor_impl(const std::string& stmt, size_t fetch_size)
+    {
+      if (!_transaction_active)
+      {
+        throw sqlpp::exception("PostgreSQL error: cursors require an active transaction");
+      }
+      if (fetch_size == 0)
+      {
+        throw sqlpp::exception("PostgreSQL error: cursor fetch size must be at least 1");
+      }
+
+      std::string name = _handle->next_cursor_name();
+      execute_direct(*_handle, "DECLARE \"" + name + "\" NO SCROLL CURSOR FOR " + stmt);
+
+      auto cursor = std::make_shared<detail::prepared_statement_handle_t>(_handle->postgres, 0, _handle->config->debug);
+      cursor->mode = detail::fetch_mode_t::cursor;
+      cursor->cursor = std::move(name);
+      cursor->fetchSize = fetch_size;
+      cursor->resultFormat = _handle->config->binary_results ? 1 : 0;
+      cursor->transactionCounter = &_handle->transaction_counter;
+      cursor->cursorTransaction = _handle->transaction_counter;
+      cursor->cursorSequence = _handle->statement_counter;
+      cursor->droppedCursors = &_handle->dropped_cursors;
+      cursor->connectionStream = &_handle->active_stream;
+      cursor->deferredCommands = &_handle->prologue;
+      cursor->asyncPending = &_handle->async_pending;
+      cursor->pipelineActive = &_handle->pipeline_active;
+      cursor->instrumentation = _handle->config->instrumentation;
+      cursor->valid = true;
+      return {cursor->take()};
+    }
+
+    copy_in_t connection::copy_into_impl(const std::string& table,
+                                         const std::vector<std::string>& columns,
+                                         copy_format_t format)
+    {
+      const std::string names = column_list(columns);
+
+      // The binary format has to match the column types exactly
+      std::vector<unsigned int> types;
+      if (format == copy_format_t::binary)
+      {
+        auto described = execute_direct(*_handle, "SELECT " + names + " FROM " + table + " LIMIT 0");
+        for (int i = 0; i < PQnfields(described->result); ++i)
+        {
+          types.push_back(PQftype(described->result, i));
+        }
+      }
+
+      std::string stmt = "COPY " + table + " (" + names + ") FROM STDIN";
+      if (format == copy_format_t::binary)
+      {
+        stmt.append(" WITH (FORMAT binary)");
+      }
+      if (_handle->config->debug)
+      {
+        std::cerr << "PostgreSQL debug: starting: " << stmt << std::endl;
+      }
+
+      check_idle(*_handle);
+      check_transaction(*_handle);
+      finish_active_stream(*_handle);
+      queue_deallocations(*_handle);
+      send_prologue(*_handle);
+      PGresult* res = PQexec(_handle->postgres, stmt.c_str());
+      ExecStatusType ret = PQresultStatus(res);
+      if (ret != PGRES_COPY_IN)
+      {
+        std::string errmsg = "PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                             std::string(PQresultErrorMessage(res));
+        PQclear(res);
+        throw sqlpp::exception(errmsg);
+      }
+      PQclear(res);
+
+      return {_handle->postgres, format, columns.size(), std::move(types), _handle->config->debug};
+    }
+
+    copy_out_t connection::copy_out_impl(const std::string& source, copy_format_t format)
+    {
+      std::string stmt = "COPY " + source + " TO STDOUT";
+      if (format == copy_format_t::binary)
+      {
+        stmt.append(" WITH (FORMAT binary)");
+      }
+      if (_handle->config->debug)
+      {
+        std::cerr << "PostgreSQL debug: starting: " << stmt << std::endl;
+      }
+
+      check_idle(*_handle);
+      check_transaction(*_handle);
+      finish_active_stream(*_handle);
+      queue_deallocations(*_handle);
+      const bool cancel_on_abandon = !in_transaction_block(*_handle);
+      send_prologue(*_handle);
+      PGresult* res = PQexec(_handle->postgres, stmt.c_str());
+      ExecStatusType ret = PQresultStatus(res);
+      if (ret != PGRES_COPY_OUT)
+      {
+        std::string errmsg = "PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                             std::string(PQresultErrorMessage(res));
+        PQclear(res);
+        throw sqlpp::exception(errmsg);
+      }
+      PQclear(res);
+
+      return {_handle->postgres, cancel_on_abandon, _handle->config->debug};
+    }
+
+    std::string connection::column_list(const std::vector<std::string>& columns)
+    {
+      std::string list;
+      for (const auto& column : columns)
+      {
+        if (!list.empty())
+        {
+          list.append(", ");
+        }
+        list.append(column);
+      }
+      return list;
+    }
+
+    size_t connection::insert_impl(const std::string& stmt)
+    {
+      return affected_rows(execute_direct(*_handle, stmt)->result);
+    }
+
+    std::vector<int64_t> connection::insert_returning_impl(const std::string& stmt)
+    {
+      bind_result_t result{execute_direct(*_handle, stmt)->take()};
+      std::vector<int64_t> values;
+      result.fetch_columns({{0, values}});
+      return values;
+    }
+
+    size_t connection::update_impl(const std::string& stmt)
+    {
+      return affected_rows(execute_direct(*_handle, stmt)->result);
+    }
+
+    size_t connection::remove_impl(const std::string& stmt)
+    {
+      return affected_rows(execute_direct(*_handle, stmt)->result);
+    }
+
+    size_t connection::execute(const std::string& command)
+    {
+      return affected_rows(execute_direct(*_handle, command)->result);
+    }
+
+    // prepared execution
+    prepared_statement_t connection::prepare_impl(const std::string& stmt, const size_t& paramCount)
+    {
+      return {prepare_statement(*_handle, stmt, paramCount)};
+    }
+
+    bind_result_t connection::run_prepared_select_impl(prepared_statement_t& prep)
+    {
+      execute_statement(*_handle, *prep._handle.get());
+
+      return {prep._handle->take()};
+    }
+
+    bind_result_t connection::run_prepared_select_streaming_impl(prepared_statement_t& prep, size_t chunk_rows)
+    {
+      start_streaming(*_handle, *prep._handle.get(), nullptr, chunk_rows);
+
+      return {prep._handle->take()};
+    }
+
+    size_t connection::run_prepared_execute_impl(prepared_statement_t& prep)
+    {
+      execute_statement(*_handle, *prep._handle.get());
+
+      return affected_rows(prep._handle->result);
+    }
+
+    prepared_statement_t connection::prepare_execute(const std::string& stmt, size_t param_count)
+    {
+      return prepare_impl(stmt, param_count);
+    }
+
+    // Parameters bound by hand are not rebound before every execution like those
+    // of sqlpp11 statements, so they are cleared after it, failed or not.
+    size_t connection::run_prepared_execute(prepared_statement_t& prep)
+    {
+      try
+      {
+        const size_t rows = run_prepared_execute_impl(prep);
+        prep._handle->clear_params();
+        return rows;
+      }
+      catch (...)
+      {
+        prep._handle->clear_params();
+        throw;
+      }
+    }
+
+    bind_result_t connection::run_prepared_select(prepared_statement_t& prep)
+    {
+      try
+      {
+        bind_result_t result = run_prepared_select_impl(prep);
+        prep._handle->clear_params();
+        return result;
+      }
+      catch (...)
+      {
+        prep._handle->clear_params();
+        throw;
+      }
+    }
+
+    size_t connection::run_prepared_insert_impl(prepared_statement_t& prep)
+    {
+      execute_statement(*_handle, *prep._handle.get());
+
+      return affected_rows(prep._handle->result);
+    }
+
+    size_t connection::run_prepared_update_impl(prepared_statement_t& prep)
+    {
+      execute_statement(*_handle, *prep._handle.get());
+
+      return affected_rows(prep._handle->result);
+    }
+
+    size_t connection::run_prepared_remove_impl(prepared_statement_t& prep)
+    {
+      execute_statement(*_handle, *prep._handle.get());
+
+      return affected_rows(prep._handle->result);
+    }
+
+    // asynchronous execution
+    void connection::async_send(const std::string* stmt,
+                                const std::shared_ptr<detail::prepared_statement_handle_t>& prepared)
+    {
+      if (_handle->async_pending)
+      {
+        throw sqlpp::exception("PostgreSQL error: another asynchronous statement is still pending");
+      }
+      check_idle(*_handle);
+
+      if (_handle->config->debug)
+      {
+        std::cerr << "PostgreSQL debug: sending asynchronously: "
+                  << (stmt ? *stmt : "prepared statement " + prepared->statement->name) << std::endl;
+      }
+
+      finish_active_stream(*_handle);
+      prepared->mode = detail::fetch_mode_t::materialized;
+      prepared->release_result();
+      prepared->count = 0;
+      prepared->totalCount = 0;
+      prepared->valid = false;
+
+      check_transaction(*_handle);
+      // The server enforces the timeout, event loops with deadlines of their own call cancel()
+      queue_timeout(*_handle);
+      queue_deallocations(*_handle);
+      send_prologue(*_handle);
+      PQsetnonblocking(_handle->postgres, 1);
+      const int resultFormat = _handle->config->binary_results ? 1 : 0;
+      int sent;
+      if (stmt)
+      {
+        sent = PQsendQueryParams(_handle->postgres, stmt->c_str(), 0, nullptr, nullptr, nullptr, nullptr,
+                                 resultFormat);
+      }
+      else
+      {
+        sent = PQsendQueryPrepared(_handle->postgres, prepared->statement->name.c_str(), prepared->param_count(),
+                                   prepared->param_values(), prepared->paramLengths.data(),
+                                   prepared->paramFormats.data(), resultFormat);
+      }
+      if (!sent || PQflush(_handle->postgres) < 0)
+      {
+        PQsetnonblocking(_handle->postgres, 0);
+        throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(_handle->postgres)));
+      }
+
+      _async_result = prepared;
+      _async_error.clear();
+      _handle->async_pending = true;
+    }
+
+    void connection::async_complete()
+    {
+      PQsetnonblocking(_handle->postgres, 0);
+      _handle->async_pending = false;
+
+      // Reset the state first, so that the callback can send the next statement
+      auto result = std::move(_async_result);
+      auto on_select = std::move(_async_select);
+      auto on_execute = std::move(_async_execute);
+      _async_result.reset();
+      _async_select = nullptr;
+      _async_execute = nullptr;
+
+      std::exception_ptr error;
+      if (!_async_error.empty())
+      {
+        error = std::make_exception_ptr(sqlpp::exception(_async_error));
+      }
+
+      if (on_select)
+      {
+        on_select(error ? bind_result_t{} : bind_result_t{result->take()}, error);
+      }
+      else if (on_execute)
+      {
+        on_execute(error ? 0 : affected_rows(result->result), error);
+      }
+    }
 
-        // Generate a random name for the prepared statement
-        while (std::find(handle.prepared_statement_names.begin(), handle.prepared_statement_names.end(), result.name) !=
-               handle.prepared_statement_names.end())
-        {
-          std::generate_n(result.name.begin(), 6, []()
-                          {
-                            const char charset[] = "0123456789"
-                                                   "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                                                   "abcdefghijklmnopqrstuvwxyz";
-                            constexpr size_t max = (sizeof(charset) - 1);
-                            std::random_device rd;
-                            return charset[rd() % max];
-                          });
-        }
-        handle.prepared_statement_names.push_back(result.name);
+    void connection::async_select_impl(const std::string& stmt, async_select_callback_t callback)
+    {
+      async_send(&stmt, std::make_shared<detail::prepared_statement_handle_t>(_handle->postgres, 0,
+                                                                               _handle->config->debug));
+      _async_select = std::move(callback);
+    }
 
-        // Create the prepared statement
-        PGresult* res = PQprepare(handle.postgres, result.name.c_str(), stmt.c_str(), 0, nullptr);
-        std::string errmsg = "PostgreSQL error: ";
-        ExecStatusType ret = PQresultStatus(res);
-        std::string rerrmsg(PQresultErrorMessage(res));
-        PQclear(res);
-        switch (ret)
-        {
-          case PGRES_EMPTY_QUERY:
-          case PGRES_COPY_OUT:
-          case PGRES_COPY_IN:
-          case PGRES_BAD_RESPONSE:
-          case PGRES_NONFATAL_ERROR:
-          case PGRES_FATAL_ERROR:
-          case PGRES_COPY_BOTH:
-            errmsg.append(std::string(PQresStatus(ret)) + std::string(": ") + rerrmsg);
-            throw sqlpp::exception(errmsg);
-          case PGRES_COMMAND_OK:
-          case PGRES_TUPLES_OK:
-          case PGRES_SINGLE_TUPLE:
-          default:
-            result.valid = true;
-            break;
-        }
+    void connection::async_execute_impl(const std::string& stmt, async_execute_callback_t callback)
+    {
+      async_send(&stmt, std::make_shared<detail::prepared_statement_handle_t>(_handle->postgres, 0,
+                                                                               _handle->config->debug));
+      _async_execute = std::move(callback);
+    }
 
-        return result;
+    void connection::run_prepared_select_async_impl(prepared_statement_t& prep, async_select_callback_t callback)
+    {
+      async_send(nullptr, prep._handle);
+      _async_select = std::move(callback);
+    }
+
+    void connection::run_prepared_execute_async_impl(prepared_statement_t& prep, async_execute_callback_t callback)
+    {
+      async_send(nullptr, prep._handle);
+      _async_execute = std::move(callback);
+    }
+
+    int connection::socket() const
+    {
+      return PQsocket(_handle->postgres);
+    }
+
+    bool connection::consume_input()
+    {
+      if (!PQconsumeInput(_handle->postgres))
+      {
+        throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(_handle->postgres)));
+      }
+      deliver_notifications(*_handle);
+      if (!_handle->async_pending)
+      {
+        return true;
       }
 
-      void execute_statement(detail::connection_handle& handle, detail::prepared_statement_handle_t& prepared)
+      // Sending may have been stalled until the server read some of our input
+      flush();
+      while (!PQisBusy(_handle->postgres))
       {
-        // Execute a prepared statement
-        char** paramValues = (char**)malloc(sizeof(char*) * prepared.paramValues.size());
-        // int paramLengths[prepared.paramValues.size()];
-        for (uint32_t i = 0; i < prepared.paramValues.size(); i++)
+        PGresult* res = PQgetResult(_handle->postgres);
+        if (!res)
         {
-          if (!prepared.nullValues[i])
-          {
-            paramValues[i] = const_cast<char*>(prepared.paramValues[i].c_str());
-            // paramLengths[i] = prepared.paramValues[i].size();
-          }
-          else
-          {
-            paramValues[i] = nullptr;
-            // paramLengths[i] = 0;
-          }
+          async_complete();
+          return true;
         }
 
-        // Execute prepared statement with the parameters.
-        if (prepared.result)
+        // Only the first result is kept, the statement is done once libpq returns null
+        if (_async_result->result || !_async_error.empty())
         {
-          PQclear(prepared.result);
-          prepared.result = nullptr;
+          PQclear(res);
+          continue;
         }
-        prepared.count = 0;
-        prepared.totalCount = 0;
-        prepared.result = PQexecPrepared(handle.postgres, prepared.name.c_str(), prepared.paramValues.size(),
-                                         paramValues, nullptr, nullptr, 0);
-
-        // check statement
-        std::string errmsg = "PostgreSQL error: ";
-        ExecStatusType ret = PQresultStatus(prepared.result);
+        ExecStatusType ret = PQresultStatus(res);
         switch (ret)
         {
-          case PGRES_EMPTY_QUERY:
-          case PGRES_COPY_OUT:
-          case PGRES_COPY_IN:
-          case PGRES_BAD_RESPONSE:
-          case PGRES_NONFATAL_ERROR:
-          case PGRES_FATAL_ERROR:
-          case PGRES_COPY_BOTH:
-            prepared.valid = false;
-            errmsg.append(std::string(PQresStatus(ret)) + std::string(": ") +
-                          std::string(PQresultErrorMessage(prepared.result)));
-			free(paramValues);
-            throw sqlpp::exception(errmsg);
           case PGRES_COMMAND_OK:
           case PGRES_TUPLES_OK:
-          case PGRES_SINGLE_TUPLE:
+            _async_result->result = res;
+            _async_result->valid = true;
+            break;
           default:
-            prepared.valid = true;
+            _async_error = "PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                           std::string(PQresultErrorMessage(res));
+            PQclear(res);
             break;
         }
-
-		free(paramValues);
       }
+      return false;
     }
 
-    connection::connection(const std::shared_ptr<connection_config>& config)
-        : _handle(new detail::connection_handle(config))
+    bool connection::flush()
     {
+      const int ret = PQflush(_handle->postgres);
+      if (ret < 0)
+      {
+        throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(_handle->postgres)));
+      }
+      return ret == 0;
     }
 
-    connection::~connection()
+    bool connection::async_pending() const
     {
+      return _handle->async_pending;
     }
 
-    connection::connection(connection&& other)
+    bool connection::is_busy() const
     {
-      this->_transaction_active = other._transaction_active;
-      this->_handle = std::move(other._handle);
+      return PQisBusy(_handle->postgres) != 0;
     }
 
-    // direct execution
-    bind_result_t connection::select_impl(const std::string& stmt)
+    void connection::wait_async()
     {
-      // Prepare statement
-      std::unique_ptr<detail::prepared_statement_handle_t> prepared(
-          new detail::prepared_statement_handle_t(prepare_statement(*_handle, stmt, 0)));
-      if (!prepared)
+      while (_handle->async_pending)
       {
-        throw sqlpp::exception("PostgreSQL error: could not store result set");
+        const bool sent = flush();
+        detail::wait_socket(_handle->postgres, true, !sent, -1);
+        consume_input();
       }
-
-      // Execute statement
-      execute_statement(*_handle, *prepared);
-      return {std::move(prepared)};
     }
 
-    size_t connection::insert_impl(const std::string& stmt)
+    size_t connection::listen(const std::string& channel, notification_callback_t callback)
     {
-      // Prepare statement
-      detail::prepared_statement_handle_t prepared = prepare_statement(*_handle, stmt, 0);
-      if (!prepared)
+      bool listening = false;
+      for (const auto& subscription : _handle->subscriptions)
       {
-        throw sqlpp::exception("PostgreSQL error: could not store result set");
+        listening = listening || subscription.second.first == channel;
       }
-
-      // Execute statement
-      execute_statement(*_handle, prepared);
-      std::istringstream in(PQcmdTuples(prepared.result));
-      size_t result;
-      in >> result;
-      return result;
-    }
-
-    size_t connection::update_impl(const std::string& stmt)
-    {
-      // Prepare statement
-      detail::prepared_statement_handle_t prepared = prepare_statement(*_handle, stmt, 0);
-      if (!prepared)
+      if (!listening)
       {
-        throw sqlpp::exception("PostgreSQL error: could not store result set");
+        execute_direct(*_handle, "LISTEN " + quote_identifier(channel));
       }
 
-      // Execute statement
-      execute_statement(*_handle, prepared);
-      std::istringstream in(PQcmdTuples(prepared.result));
-      size_t result;
-      in >> result;
-      return result;
+      const size_t id = ++_handle->subscription_counter;
+      _handle->subscriptions.emplace(id, std::make_pair(channel, std::move(callback)));
+      return id;
     }
 
-    size_t connection::remove_impl(const std::string& stmt)
+    void connection::unlisten(size_t subscription)
     {
-      // Prepare statement
-      detail::prepared_statement_handle_t prepared = prepare_statement(*_handle, stmt, 0);
-      if (!prepared)
+      auto it = _handle->subscriptions.find(subscription);
+      if (it == _handle->subscriptions.end())
       {
-        throw sqlpp::exception("PostgreSQL error: could not store result set");
+        throw sqlpp::exception("PostgreSQL error: unknown notification subscription");
       }
+      const std::string channel = std::move(it->second.first);
+      _handle->subscriptions.erase(it);
 
-      // Execute statement
-      execute_statement(*_handle, prepared);
-      std::istringstream in(PQcmdTuples(prepared.result));
-      size_t result;
-      in >> result;
-      return result;
+      for (const auto& other : _handle->subscriptions)
+      {
+        if (other.second.first == channel)
+        {
+          return;
+        }
+      }
+      execute_direct(*_handle, "UNLISTEN " + quote_identifier(channel));
     }
 
-    // prepared execution
-    prepared_statement_t connection::prepare_impl(const std::string& stmt, const size_t& paramCount)
+    void connection::notify(const std::string& channel, const std::string& payload)
     {
-      return {std::unique_ptr<detail::prepared_statement_handle_t>(
-          new detail::prepared_statement_handle_t(prepare_statement(*_handle, stmt, paramCount)))};
+      std::string command = "NOTIFY " + quote_identifier(channel);
+      if (!payload.empty())
+      {
+        command.append(", '");
+        escape_append(command, payload);
+        command.append("'");
+      }
+      execute_direct(*_handle, command);
     }
 
-    bind_result_t connection::run_prepared_select_impl(prepared_statement_t& prep)
+    bool connection::next_notification(notification_t& notification)
     {
-      execute_statement(*_handle, *prep._handle.get());
-
-      return {prep._handle};
+      if (!PQconsumeInput(_handle->postgres))
+      {
+        throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(_handle->postgres)));
+      }
+      PGnotify* received = PQnotifies(_handle->postgres);
+      if (!received)
+      {
+        return false;
+      }
+      notification.channel = received->relname;
+      notification.payload = received->extra ? received->extra : "";
+      notification.backend_pid = received->be_pid;
+      PQfreemem(received);
+      return true;
     }
 
-    size_t connection::run_prepared_execute_impl(prepared_statement_t& prep)
+    size_t connection::dispatch_notifications()
     {
-      execute_statement(*_handle, *prep._handle.get());
-
-      std::istringstream in(PQcmdTuples(prep._handle->result));
-      size_t result;
-      in >> result;
-      return result;
+      if (!PQconsumeInput(_handle->postgres))
+      {
+        throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(_handle->postgres)));
+      }
+      return deliver_notifications(*_handle);
     }
 
-    size_t connection::run_prepared_insert_impl(prepared_statement_t& prep)
+    size_t connection::wait_notifications(std::chrono::milliseconds timeout)
     {
-      execute_statement(*_handle, *prep._handle.get());
-
-      std::istringstream in(PQcmdTuples(prep._handle->result));
-      size_t result;
-      in >> result;
-      return result;
+      // Notifications may have been queued while executing statements
+      size_t count = deliver_notifications(*_handle);
+      const int timeout_ms = timeout.count() < 0 ? -1 : static_cast<int>(timeout.count());
+      if (count == 0 && detail::wait_socket(_handle->postgres, true, false, timeout_ms))
+      {
+        count = dispatch_notifications();
+      }
+      return count;
     }
 
-    size_t connection::run_prepared_update_impl(prepared_statement_t& prep)
+    std::string connection::escape(const std::string& s) const
     {
-      execute_statement(*_handle, *prep._handle.get());
-
-      std::istringstream in(PQcmdTuples(prep._handle->result));
-      size_t result;
-      in >> result;
+      std::string result;
+      escape_append(result, s);
       return result;
     }
 
-    size_t connection::run_prepared_remove_impl(prepared_statement_t& prep)
+    void connection::escape_append(std::string& out, const std::string& s) const
     {
-      execute_statement(*_handle, *prep._handle.get());
+      // Without quote or backslash bytes there is nothing to escape in any client encoding,
+      // multibyte characters containing such a byte take the slow path as well.
+      if (s.find_first_of("'\\") == std::string::npos)
+      {
+        out.append(s);
+        return;
+      }
 
-      std::istringstream in(PQcmdTuples(prep._handle->result));
-      size_t result;
-      in >> result;
-      return result;
+      // Escape in place at the end of the output, which needs room for 2n+1 characters
+      const size_t start = out.size();
+      out.resize(start + s.size() * 2 + 1);
+      int err = 0;
+      const size_t length = PQescapeStringConn(_handle->postgres, &out[start], s.data(), s.size(), &err);
+      out.resize(err ? start : start + length);
+      if (err)
+      {
+        throw sqlpp::exception("PostgreSQL error: cannot escape string: " +
+                               std::string(PQerrorMessage(_handle->postgres)));
+      }
     }
 
-    // TODO: Fix escaping.
-    std::string connection::escape(const std::string& s) const
+    //! start transaction
+    void connection::start_transaction()
     {
-      // Escape strings
-      char* to = (char*)malloc((s.size() * 2) + 1);
-      int err;
-      size_t length = PQescapeStringConn(_handle->postgres, to, s.c_str(), s.size(), &err);
-      std::string result(to, length);
-	  free(to);
-      return result;
+      start_transaction(isolation_level_t::server_default);
     }
 
-    //! start transaction
-    void connection::start_transaction()
+    void connection::start_transaction(isolation_level_t isolation, bool read_only)
     {
       if (_transaction_active)
       {
         throw sqlpp::exception("PostgreSQL error: transaction already open");
       }
+      check_idle(*_handle);
 
-      auto prepared = prepare_statement(*_handle, "BEGIN", 0);
-      execute_statement(*_handle, prepared);
+      std::string begin = "BEGIN";
+      switch (isolation)
+      {
+        case isolation_level_t::server_default:
+          break;
+        case isolation_level_t::read_committed:
+          begin.append(" ISOLATION LEVEL READ COMMITTED");
+          break;
+        case isolation_level_t::repeatable_read:
+          begin.append(" ISOLATION LEVEL REPEATABLE READ");
+          break;
+        case isolation_level_t::serializable:
+          begin.append(" ISOLATION LEVEL SERIALIZABLE");
+          break;
+      }
+      if (read_only)
+      {
+        begin.append(" READ ONLY");
+      }
+
+      _handle->savepoints.clear();
+      _handle->dropped_cursors.clear();
+      if (_handle->config->deferred_transactions)
+      {
+        _handle->prologue.push_back(std::move(begin));
+        _handle->begin_deferred = true;
+      }
+      else
+      {
+        execute_direct(*_handle, begin);
+      }
       _transaction_active = true;
+      ++_handle->transaction_counter;
     }
 
     //! commit transaction (or throw transaction if transaction has
@@ -324,10 +1374,54 @@ namespace sqlpp
       {
         throw sqlpp::exception("PostgreSQL error: transaction failed or finished.");
       }
+      check_idle(*_handle);
 
       _transaction_active = false;
-      auto prepared = prepare_statement(*_handle, "COMMIT", 0);
-      execute_statement(*_handle, prepared);
+      ++_handle->transaction_counter;
+      if (_handle->transaction_failed)
+      {
+        // A COMMIT would roll an aborted transaction back silently, end it explicitly and report it
+        _handle->prologue.clear();
+        _handle->transaction_failed = false;
+        if (server_transaction(*_handle))
+        {
+          try
+          {
+            execute_direct(*_handle, "ROLLBACK", true);
+          }
+          catch (const sqlpp::exception&)
+          {
+          }
+          _handle->session_timeout = -1;
+        }
+        throw sqlpp::exception("PostgreSQL error: the transaction failed, nothing was committed");
+      }
+      // A deferred transaction without statements never reached the server,
+      // otherwise any deferred savepoint commands go out together with the COMMIT
+      if (_handle->begin_deferred)
+      {
+        _handle->prologue.clear();
+        _handle->begin_deferred = false;
+        return;
+      }
+      std::shared_ptr<detail::prepared_statement_handle_t> committed;
+      try
+      {
+        committed = execute_direct(*_handle, "COMMIT", true);
+      }
+      catch (...)
+      {
+        // A deferred savepoint command failed and the COMMIT was skipped, leave the transaction block
+        finish_active_stream(*_handle);
+        PQclear(PQexec(_handle->postgres, "ROLLBACK"));
+        _handle->session_timeout = -1;
+        throw;
+      }
+      // Committing a failed transaction rolls it back, undoing a statement timeout set within it
+      if (std::string(PQcmdStatus(committed->result)) != "COMMIT")
+      {
+        _handle->session_timeout = -1;
+      }
     }
 
     //! rollback transaction
@@ -337,14 +1431,34 @@ namespace sqlpp
       {
         throw sqlpp::exception("PostgreSQL error: transaction failed or finished.");
       }
+      check_idle(*_handle);
       if (report)
       {
         std::cerr << "PostgreSQL warning: rolling back unfinished transaction" << std::endl;
       }
 
       _transaction_active = false;
-      auto prepared = prepare_statement(*_handle, "ROLLBACK", 0);
-      execute_statement(*_handle, prepared);
+      ++_handle->transaction_counter;
+      // Deferred savepoint commands are moot, the whole transaction is undone
+      _handle->prologue.clear();
+      const bool failed_to_start = _handle->transaction_failed && !server_transaction(*_handle);
+      _handle->transaction_failed = false;
+      if (_handle->begin_deferred || failed_to_start)
+      {
+        _handle->begin_deferred = false;
+        return;
+      }
+      try
+      {
+        execute_direct(*_handle, "ROLLBACK", true);
+      }
+      catch (...)
+      {
+        _handle->session_timeout = -1;
+        throw;
+      }
+      // A statement timeout set within the transaction is undone as well
+      _handle->session_timeout = -1;
     }
 
     //! report rollback failure
@@ -353,16 +1467,209 @@ namespace sqlpp
       std::cerr << "PostgreSQL error: " << message << std::endl;
     }
 
-    uint64_t connection::last_insert_id(const std::string& table, const std::string& fieldname)
+    savepoint_t connection::start_savepoint()
+    {
+      return savepoint_t(*this, _handle->next_savepoint_name());
+    }
+
+    void connection::savepoint(const std::string& name)
+    {
+      if (!_transaction_active)
+      {
+        throw sqlpp::exception("PostgreSQL error: savepoints require an open transaction");
+      }
+      _handle->savepoints.emplace_back(name, _handle->statement_counter);
+      _handle->prologue.push_back("SAVEPOINT " + quote_identifier(name));
+      if (!_handle->config->deferred_transactions)
+      {
+        send_prologue(*_handle);
+      }
+    }
+
+    // Savepoint commands are collected in the prologue. A scope whose SAVEPOINT
+    // has not been sent yet contains no statements, so releasing or rolling it
+    // back only drops the commands queued since, without talking to the server.
+    void connection::release_savepoint(const std::string& name)
+    {
+      if (!_transaction_active)
+      {
+        throw sqlpp::exception("PostgreSQL error: savepoints require an open transaction");
+      }
+      const auto known = find_savepoint(*_handle, name);
+      _handle->savepoints.erase(known, _handle->savepoints.end());
+
+      auto& prologue = _handle->prologue;
+      const auto created = std::find(prologue.rbegin(), prologue.rend(), "SAVEPOINT " + quote_identifier(name));
+      if (created != prologue.rend())
+      {
+        prologue.erase(std::prev(created.base()), prologue.end());
+        return;
+      }
+      prologue.push_back("RELEASE SAVEPOINT " + quote_identifier(name));
+      if (!_handle->config->deferred_transactions)
+      {
+        send_prologue(*_handle);
+      }
+    }
+
+    void connection::rollback_to_savepoint(const std::string& name, bool release)
+    {
+      if (!_transaction_active)
+      {
+        throw sqlpp::exception("PostgreSQL error: savepoints require an open transaction");
+      }
+      // Rolling back to a savepoint recovers a transaction a failed pipeline statement aborted
+      if (_handle->transaction_failed && server_transaction(*_handle))
+      {
+        _handle->transaction_failed = false;
+      }
+      // The cursors declared since the savepoint are gone, for an unknown savepoint all of the transaction's
+      const auto known = find_savepoint(*_handle, name);
+      const uint64_t created_at = known != _handle->savepoints.end() ? known->second : 0;
+      _handle->dropped_cursors.emplace_back(created_at, _handle->statement_counter);
+      _handle->savepoints.erase(release || known == _handle->savepoints.end() ? known : std::next(known),
+                                _handle->savepoints.end());
+
+      auto& prologue = _handle->prologue;
+      const auto created = std::find(prologue.rbegin(), prologue.rend(), "SAVEPOINT " + quote_identifier(name));
+      if (created != prologue.rend())
+      {
+        prologue.erase(release ? std::prev(created.base()) : created.base(), prologue.end());
+        return;
+      }
+      prologue.push_back("ROLLBACK TO SAVEPOINT " + quote_identifier(name));
+      _handle->session_timeout = -1;
+      if (release)
+      {
+        prologue.push_back("RELEASE SAVEPOINT " + quote_identifier(name));
+      }
+      // Both commands share one round trip
+      if (!_handle->config->deferred_transactions)
+      {
+        send_prologue(*_handle);
+      }
+    }
+
+    void connection::set_statement_timeout(std::chrono::milliseconds timeout)
+    {
+      _handle->statement_timeout = std::max(timeout, std::chrono::milliseconds(0));
+    }
+
+    std::chrono::milliseconds connection::statement_timeout() const
     {
-      std::string sql = "SELECT currval('" + table + "_" + fieldname + "_seq')";
-      PGresult* res = PQexec(_handle->postgres, sql.c_str());
+      return _handle->statement_timeout;
+    }
+
+    bool connection::cancel()
+    {
+      return request_cancel(*_handle);
+    }
 
-      // Parse the number and return.
-      // TODO: A copy is happening here, how to prevent that?
-      std::string in{PQgetvalue(res, 0, 0)};
+    bool connection::is_valid() const
+    {
+      return PQstatus(_handle->postgres) == CONNECTION_OK;
+    }
+
+    bool connection::ping()
+    {
+      if (!is_valid() || _handle->async_pending)
+      {
+        return false;
+      }
+      finish_active_stream(*_handle);
+      PGresult* res = PQexec(_handle->postgres, "");
+      const bool alive = PQresultStatus(res) == PGRES_EMPTY_QUERY;
       PQclear(res);
-      return std::stoi(in);
+      return alive;
+    }
+
+    void connection::reconnect()
+    {
+      if (_handle->config->debug)
+      {
+        std::cerr << "PostgreSQL debug: reconnecting to the database server." << std::endl;
+      }
+
+      // The server forgot the old session's statements, so nothing must be DEALLOCATEd
+      _handle->statement_cache.clear(true);
+      _handle->deallocations.clear();
+      ++_handle->session;
+      _async_result.reset();
+      _async_select = nullptr;
+      _async_execute = nullptr;
+      _handle->async_pending = false;
+      _handle->prologue.clear();
+      _handle->begin_deferred = false;
+      _handle->transaction_failed = false;
+      if (_transaction_active)
+      {
+        _transaction_active = false;
+        ++_handle->transaction_counter;
+      }
+
+      PQreset(_handle->postgres);
+      if (!is_valid())
+      {
+        throw sqlpp::exception("PostgreSQL error: reconnect failed: " + std::string(PQerrorMessage(_handle->postgres)));
+      }
+      PQsetnonblocking(_handle->postgres, 0);
+      _handle->renew_cancel_token();
+      _handle->session_timeout = 0;
+
+      // The new session has to LISTEN again
+      std::vector<std::string> channels;
+      for (const auto& subscription : _handle->subscriptions)
+      {
+        if (std::find(channels.begin(), channels.end(), subscription.second.first) == channels.end())
+        {
+          channels.push_back(subscription.second.first);
+          execute_direct(*_handle, "LISTEN " + quote_identifier(subscription.second.first));
+        }
+      }
+    }
+
+    uint64_t connection::last_insert_id(const std::string& table, const std::string& fieldname)
+    {
+      const std::string stmt = "SELECT currval('" + table + "_" + fieldname + "_seq')";
+      bind_result_t result{execute_direct(*_handle, stmt)->take()};
+      std::vector<int64_t> values;
+      result.fetch_columns({{0, values}});
+      if (values.empty())
+      {
+        throw sqlpp::exception("PostgreSQL error: currval returned no rows");
+      }
+      return static_cast<uint64_t>(values.front());
+    }
+
+    size_t connection::statement_cache_hits() const
+    {
+      return _handle->statement_cache.hits;
+    }
+
+    size_t connection::statement_cache_misses() const
+    {
+      return _handle->statement_cache.misses;
+    }
+
+    size_t connection::statement_cache_size() const
+    {
+      return _handle->statement_cache.size();
+    }
+
+    pipeline_t connection::pipeline()
+    {
+      check_idle(*_handle);
+      finish_active_stream(*_handle);
+      check_transaction(*_handle);
+      queue_timeout(*_handle);
+      queue_deallocations(*_handle);
+      send_prologue(*_handle);
+      return pipeline_t(*this, *_handle, _transaction_active);
+    }
+
+    const connect_timings_t& connection::connect_timings() const
+    {
+      return _handle->timings;
     }
 
     ::PGconn* connection::native_handle()
@@ -0,0 +1,206 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sqlpp11/postgresql/connection_pool.h>
+#include <sqlpp11/exception.h>
+
+#include <iostream>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    connection_pool::connection_pool(const connection_pool_config& config) : _config(config)
+    {
+      if (!_config.connection)
+      {
+        throw sqlpp::exception("PostgreSQL error: connection pool without connection config");
+      }
+      if (_config.max_size == 0 || _config.min_size > _config.max_size)
+      {
+        throw sqlpp::exception("PostgreSQL error: connection pool needs 0 < max_size and min_size <= max_size");
+      }
+
+      // Pay for connection setup, authentication and TLS before the first checkout,
+      // with the handshakes of all connections overlapped
+      for (auto& conn : connection::connect_parallel(_config.connection, _config.min_size))
+      {
+        _idle.push_back({std::move(conn), clock_t::now()});
+        ++_open;
+      }
+    }
+
+    connection_pool::~connection_pool()
+    {
+    }
+
+    std::unique_ptr<connection> connection_pool::open()
+    {
+      return std::unique_ptr<connection>(new connection(_config.connection));
+    }
+
+    void connection_pool::close_expired(std::vector<std::unique_ptr<connection>>& expired)
+    {
+      // _idle is ordered by the time connections were returned, oldest first
+      const auto now = clock_t::now();
+      auto it = _idle.begin();
+      while (it != _idle.end() && _open > _config.min_size && now - it->since > _config.max_idle)
+      {
+        expired.push_back(std::move(it->conn));
+        --_open;
+        ++it;
+      }
+      _idle.erase(_idle.begin(), it);
+    }
+
+    std::unique_ptr<connection> connection_pool::checkout()
+    {
+      std::vector<std::unique_ptr<connection>> expired;
+      std::unique_ptr<connection> conn;
+      clock_t::duration idle_for{0};
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        close_expired(expired);
+
+        const auto deadline = clock_t::now() + _config.checkout_timeout;
+        while (_idle.empty() && _open >= _config.max_size)
+        {
+          if (_config.checkout_timeout.count() == 0)
+          {
+            _returned.wait(lock);
+          }
+          else if (_returned.wait_until(lock, deadline) == std::cv_status::timeout && _idle.empty() &&
+                   _open >= _config.max_size)
+          {
+            throw sqlpp::exception("PostgreSQL error: timed out waiting for a pooled connection");
+          }
+        }
+
+        if (!_idle.empty())
+        {
+          conn = std::move(_idle.back().conn);
+          idle_for = clock_t::now() - _idle.back().since;
+          _idle.pop_back();
+        }
+        else
+        {
+          // Reserve the slot, the connection is opened without holding the lock
+          ++_open;
+        }
+      }
+      // Close expired connections without holding the lock
+      expired.clear();
+
+      try
+      {
+        if (!conn)
+        {
+          return open();
+        }
+
+        if (!conn->is_valid() || (idle_for > _config.validate_after && !conn->ping()))
+        {
+          if (_config.connection->debug)
+          {
+            std::cerr << "PostgreSQL debug: pooled connection is broken, reconnecting." << std::endl;
+          }
+          conn->reconnect();
+        }
+        return conn;
+      }
+      catch (...)
+      {
+        conn.reset();
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          --_open;
+        }
+        _returned.notify_one();
+        throw;
+      }
+    }
+
+    connection_pool::pooled_connection connection_pool::get()
+    {
+      return pooled_connection(*this, checkout());
+    }
+
+    void connection_pool::release(std::unique_ptr<connection> conn)
+    {
+      // Only clean connections go back into the pool
+      try
+      {
+        if (conn->is_transaction_active())
+        {
+          conn->rollback_transaction(false);
+        }
+      }
+      catch (const sqlpp::exception&)
+      {
+        conn.reset();
+      }
+      if (conn && (conn->async_pending() || !conn->is_valid()))
+      {
+        conn.reset();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (conn)
+        {
+          _idle.push_back({std::move(conn), clock_t::now()});
+        }
+        else
+        {
+          --_open;
+        }
+      }
+      _returned.notify_one();
+    }
+
+    void connection_pool::evict_idle()
+    {
+      std::vector<std::unique_ptr<connection>> expired;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        close_expired(expired);
+      }
+    }
+
+    size_t connection_pool::size() const
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _open;
+    }
+
+    size_t connection_pool::idle() const
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _idle.size();
+    }
+  }
+}
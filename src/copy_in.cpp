@@ -0,0 +1,406 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sqlpp11/postgresql/copy_in.h>
+#include <sqlpp11/postgresql/numeric_format.h>
+#include <sqlpp11/exception.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "detail/binary_format.h"
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    namespace
+    {
+      // Rows are handed to libpq once this much data has been buffered
+      constexpr size_t flush_threshold = 64 * 1024;
+
+      const char binary_signature[] = "PGCOPY\n\377\r\n";  // followed by a '\0'
+
+      std::string unsupported_binary_type(const char* source, unsigned int type)
+      {
+        return "PostgreSQL error: cannot COPY " + std::string(source) + " value into binary column of type " +
+               std::to_string(type);
+      }
+
+      void append_uint16(std::string& buffer, uint16_t value)
+      {
+        char data[2];
+        detail::write_uint16(data, value);
+        buffer.append(data, sizeof(data));
+      }
+
+      void append_uint32(std::string& buffer, uint32_t value)
+      {
+        char data[4];
+        detail::write_uint32(data, value);
+        buffer.append(data, sizeof(data));
+      }
+
+      void append_uint64(std::string& buffer, uint64_t value)
+      {
+        char data[8];
+        detail::write_uint64(data, value);
+        buffer.append(data, sizeof(data));
+      }
+    }
+
+    copy_in_t::copy_in_t(
+        PGconn* connection, copy_format_t format, size_t columns, std::vector<unsigned int> types, bool debug)
+        : _connection(connection),
+          _format(format),
+          _columns(columns),
+          _types(std::move(types)),
+          _active(true),
+          _debug(debug)
+    {
+      _buffer.reserve(flush_threshold + 1024);
+      if (_format == copy_format_t::binary)
+      {
+        // Header: signature, flags and the length of the (empty) header extension
+        _buffer.append(binary_signature, sizeof(binary_signature));
+        append_uint32(_buffer, 0);
+        append_uint32(_buffer, 0);
+      }
+    }
+
+    copy_in_t::copy_in_t(copy_in_t&& other)
+        : _connection(other._connection),
+          _format(other._format),
+          _columns(other._columns),
+          _types(std::move(other._types)),
+          _buffer(std::move(other._buffer)),
+          _column(other._column),
+          _row_start(other._row_start),
+          _active(other._active),
+          _debug(other._debug)
+    {
+      other._active = false;
+    }
+
+    copy_in_t::~copy_in_t()
+    {
+      if (_active)
+      {
+        abort();
+      }
+    }
+
+    void copy_in_t::abort() noexcept
+    {
+      if (_debug)
+      {
+        std::cerr << "PostgreSQL debug: aborting unfinished COPY" << std::endl;
+      }
+
+      _active = false;
+      PQputCopyEnd(_connection, "COPY aborted by client");
+      while (PGresult* result = PQgetResult(_connection))
+      {
+        PQclear(result);
+      }
+    }
+
+    void copy_in_t::flush()
+    {
+      if (_buffer.empty())
+      {
+        return;
+      }
+
+      if (PQputCopyData(_connection, _buffer.data(), static_cast<int>(_buffer.size())) != 1)
+      {
+        std::string errmsg = "PostgreSQL error: " + std::string(PQerrorMessage(_connection));
+        abort();
+        throw sqlpp::exception(errmsg);
+      }
+      _buffer.clear();
+    }
+
+    void copy_in_t::begin_field()
+    {
+      if (!_active)
+      {
+        throw sqlpp::exception("PostgreSQL error: COPY is not active");
+      }
+      if (_column >= _columns)
+      {
+        reject_row("PostgreSQL error: too many values for COPY row");
+      }
+
+      if (_column == 0)
+      {
+        _row_start = _buffer.size();
+      }
+      if (_format == copy_format_t::binary)
+      {
+        if (_column == 0)
+        {
+          append_uint16(_buffer, static_cast<uint16_t>(_columns));
+        }
+      }
+      else if (_column > 0)
+      {
+        _buffer.push_back('\t');
+      }
+      ++_column;
+    }
+
+    void copy_in_t::reject_row(const std::string& message)
+    {
+      // Drop what has been written of the row, so that the next row can be added
+      _buffer.resize(_row_start);
+      _column = 0;
+      throw sqlpp::exception(message);
+    }
+
+    void copy_in_t::_write_boolean(bool value)
+    {
+      begin_field();
+      if (_format == copy_format_t::text)
+      {
+        _buffer.push_back(value ? 't' : 'f');
+        return;
+      }
+
+      if (_types[_column - 1] != detail::oid::boolean)
+      {
+        reject_row(unsupported_binary_type("boolean", _types[_column - 1]));
+      }
+      append_uint32(_buffer, 1);
+      _buffer.push_back(value ? 1 : 0);
+    }
+
+    void copy_in_t::_write_floating_point(double value)
+    {
+      begin_field();
+      if (_format == copy_format_t::text)
+      {
+        // The shortest representation that reads back to the same value
+        char data[32];
+        int length = detail::format_double(data, sizeof(data), "%.15g", value);
+        if (detail::parse_double(data) != value)
+        {
+          length = detail::format_double(data, sizeof(data), "%.17g", value);
+        }
+        _buffer.append(data, static_cast<size_t>(length));
+        return;
+      }
+
+      char data[8];
+      switch (_types[_column - 1])
+      {
+        case detail::oid::float4:
+          detail::write_float4(data, static_cast<float>(value));
+          append_uint32(_buffer, 4);
+          _buffer.append(data, 4);
+          break;
+        case detail::oid::float8:
+          detail::write_float8(data, value);
+          append_uint32(_buffer, 8);
+          _buffer.append(data, 8);
+          break;
+        default:
+          reject_row(unsupported_binary_type("floating_point", _types[_column - 1]));
+      }
+    }
+
+    void copy_in_t::_write_integral(int64_t value)
+    {
+      begin_field();
+      if (_format == copy_format_t::text)
+      {
+        char data[24];
+        int length = std::snprintf(data, sizeof(data), "%lld", static_cast<long long>(value));
+        _buffer.append(data, static_cast<size_t>(length));
+        return;
+      }
+
+      const unsigned int type = _types[_column - 1];
+      if (!detail::fits_integral_type(type, value))
+      {
+        reject_row("PostgreSQL error: value " + std::to_string(value) + " out of range for COPY column of type " +
+                   std::to_string(type));
+      }
+      switch (type)
+      {
+        case detail::oid::int2:
+          append_uint32(_buffer, 2);
+          append_uint16(_buffer, static_cast<uint16_t>(value));
+          break;
+        case detail::oid::int4:
+        case detail::oid::oid:
+          append_uint32(_buffer, 4);
+          append_uint32(_buffer, static_cast<uint32_t>(value));
+          break;
+        case detail::oid::int8:
+          append_uint32(_buffer, 8);
+          append_uint64(_buffer, static_cast<uint64_t>(value));
+          break;
+        default:
+          reject_row(unsupported_binary_type("integral", type));
+      }
+    }
+
+    void copy_in_t::_write_text(const char* value, size_t len)
+    {
+      begin_field();
+      if (_format == copy_format_t::binary)
+      {
+        const unsigned int type = _types[_column - 1];
+        if (type == detail::oid::jsonb)
+        {
+          // jsonb is prefixed with a one byte format version
+          append_uint32(_buffer, static_cast<uint32_t>(len + 1));
+          _buffer.push_back(1);
+        }
+        else if (detail::is_text_type(type))
+        {
+          append_uint32(_buffer, static_cast<uint32_t>(len));
+        }
+        else
+        {
+          reject_row(unsupported_binary_type("text", type));
+        }
+        _buffer.append(value, len);
+      }
+      else
+      {
+        // Escape the characters that are special in the text format
+        for (size_t i = 0; i < len; ++i)
+        {
+          switch (value[i])
+          {
+            case '\\':
+              _buffer.append("\\\\", 2);
+              break;
+            case '\t':
+              _buffer.append("\\t", 2);
+              break;
+            case '\n':
+              _buffer.append("\\n", 2);
+              break;
+            case '\r':
+              _buffer.append("\\r", 2);
+              break;
+            default:
+              _buffer.push_back(value[i]);
+              break;
+          }
+        }
+      }
+    }
+
+    void copy_in_t::_write_null()
+    {
+      begin_field();
+      if (_format == copy_format_t::binary)
+      {
+        append_uint32(_buffer, static_cast<uint32_t>(-1));
+      }
+      else
+      {
+        _buffer.append("\\N", 2);
+      }
+    }
+
+    void copy_in_t::_end_row()
+    {
+      if (_column != _columns)
+      {
+        reject_row("PostgreSQL error: COPY row has " + std::to_string(_column) + " values, expected " +
+                   std::to_string(_columns));
+      }
+
+      if (_format == copy_format_t::text)
+      {
+        _buffer.push_back('\n');
+      }
+      _column = 0;
+
+      if (_buffer.size() >= flush_threshold)
+      {
+        flush();
+      }
+    }
+
+    size_t copy_in_t::finish()
+    {
+      if (!_active)
+      {
+        throw sqlpp::exception("PostgreSQL error: COPY is not active");
+      }
+      if (_column != 0)
+      {
+        throw sqlpp::exception("PostgreSQL error: COPY row is incomplete");
+      }
+
+      if (_format == copy_format_t::binary)
+      {
+        // File trailer
+        append_uint16(_buffer, static_cast<uint16_t>(-1));
+      }
+      flush();
+
+      _active = false;
+      if (PQputCopyEnd(_connection, nullptr) != 1)
+      {
+        throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(_connection)));
+      }
+
+      PGresult* result = PQgetResult(_connection);
+      ExecStatusType ret = PQresultStatus(result);
+      std::string errmsg;
+      size_t rows = 0;
+      if (ret == PGRES_COMMAND_OK)
+      {
+        rows = std::strtoull(PQcmdTuples(result), nullptr, 10);
+      }
+      else
+      {
+        errmsg = "PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                 std::string(PQresultErrorMessage(result));
+      }
+      PQclear(result);
+      while ((result = PQgetResult(_connection)))
+      {
+        PQclear(result);
+      }
+
+      if (!errmsg.empty())
+      {
+        throw sqlpp::exception(errmsg);
+      }
+      return rows;
+    }
+  }
+}
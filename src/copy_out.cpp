@@ -0,0 +1,170 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sqlpp11/postgresql/copy_out.h>
+#include <sqlpp11/exception.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <libpq-fe.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    copy_out_t::copy_out_t(PGconn* connection, bool cancel_on_abandon, bool debug)
+        : _connection(connection), _active(true), _cancel_on_abandon(cancel_on_abandon), _debug(debug)
+    {
+    }
+
+    copy_out_t::copy_out_t(copy_out_t&& other)
+        : _connection(other._connection),
+          _buffer(other._buffer),
+          _rows(other._rows),
+          _active(other._active),
+          _cancel_on_abandon(other._cancel_on_abandon),
+          _debug(other._debug)
+    {
+      other._buffer = nullptr;
+      other._active = false;
+    }
+
+    copy_out_t::~copy_out_t()
+    {
+      release_buffer();
+      if (_active)
+      {
+        abort();
+      }
+    }
+
+    void copy_out_t::release_buffer()
+    {
+      if (_buffer)
+      {
+        PQfreemem(_buffer);
+        _buffer = nullptr;
+      }
+    }
+
+    void copy_out_t::abort() noexcept
+    {
+      if (_debug)
+      {
+        std::cerr << "PostgreSQL debug: abandoning unfinished COPY" << std::endl;
+      }
+
+      // Discard the data that has arrived already, the COPY may have completed meanwhile
+      _active = false;
+      char* data;
+      int received;
+      PQconsumeInput(_connection);
+      while ((received = PQgetCopyData(_connection, &data, 1)) > 0)
+      {
+        PQfreemem(data);
+      }
+      if (received == 0)
+      {
+        // There is no way to end a COPY TO STDOUT early but to cancel it, which
+        // would fail the surrounding transaction. Then discard the rest.
+        if (_cancel_on_abandon)
+        {
+          PGcancel* cancel = PQgetCancel(_connection);
+          if (cancel)
+          {
+            char errbuf[256];
+            PQcancel(cancel, errbuf, sizeof(errbuf));
+            PQfreeCancel(cancel);
+          }
+        }
+        while (PQgetCopyData(_connection, &data, 0) > 0)
+        {
+          PQfreemem(data);
+        }
+      }
+      while (PGresult* result = PQgetResult(_connection))
+      {
+        PQclear(result);
+      }
+    }
+
+    bool copy_out_t::next(const char** data, size_t* len)
+    {
+      release_buffer();
+      if (!_active)
+      {
+        return false;
+      }
+
+      int received = PQgetCopyData(_connection, &_buffer, 0);
+      if (received > 0)
+      {
+        *data = _buffer;
+        *len = static_cast<size_t>(received);
+        return true;
+      }
+
+      _active = false;
+      if (received == -2)
+      {
+        std::string errmsg = "PostgreSQL error: " + std::string(PQerrorMessage(_connection));
+        while (PGresult* result = PQgetResult(_connection))
+        {
+          PQclear(result);
+        }
+        throw sqlpp::exception(errmsg);
+      }
+
+      // The COPY is complete, collect its final status
+      PGresult* result = PQgetResult(_connection);
+      ExecStatusType ret = PQresultStatus(result);
+      std::string errmsg;
+      if (ret == PGRES_COMMAND_OK)
+      {
+        _rows = std::strtoull(PQcmdTuples(result), nullptr, 10);
+      }
+      else
+      {
+        errmsg = "PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                 std::string(PQresultErrorMessage(result));
+      }
+      PQclear(result);
+      while ((result = PQgetResult(_connection)))
+      {
+        PQclear(result);
+      }
+
+      if (!errmsg.empty())
+      {
+        throw sqlpp::exception(errmsg);
+      }
+      return false;
+    }
+  }
+}
@@ -0,0 +1,184 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_BINARY_FORMAT_H
+#define SQLPP_POSTGRESQL_BINARY_FORMAT_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <libpq-fe.h>
+
+#include <sqlpp11/postgresql/column_type.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    namespace detail
+    {
+      // Type OIDs of the built-in types the connector knows about (see pg_type.h)
+      namespace oid
+      {
+        constexpr Oid boolean = 16;
+        constexpr Oid bytea = 17;
+        constexpr Oid character = 18;
+        constexpr Oid name = 19;
+        constexpr Oid int8 = 20;
+        constexpr Oid int2 = 21;
+        constexpr Oid int4 = 23;
+        constexpr Oid text = 25;
+        constexpr Oid oid = 26;
+        constexpr Oid json = 114;
+        constexpr Oid xml = 142;
+        constexpr Oid float4 = 700;
+        constexpr Oid float8 = 701;
+        constexpr Oid unknown = 705;
+        constexpr Oid bpchar = 1042;
+        constexpr Oid varchar = 1043;
+        constexpr Oid numeric = 1700;
+        constexpr Oid jsonb = 3802;
+
+        // One dimensional arrays of the above
+        constexpr Oid boolean_array = 1000;
+        constexpr Oid int2_array = 1005;
+        constexpr Oid int4_array = 1007;
+        constexpr Oid text_array = 1009;
+        constexpr Oid bpchar_array = 1014;
+        constexpr Oid varchar_array = 1015;
+        constexpr Oid int8_array = 1016;
+        constexpr Oid float4_array = 1021;
+        constexpr Oid float8_array = 1022;
+        constexpr Oid oid_array = 1028;
+      }
+
+      //! Returns the element type of the array types above, or 0 for any other type.
+      inline Oid array_element_type(Oid type)
+      {
+        switch (type)
+        {
+          case oid::boolean_array:
+            return oid::boolean;
+          case oid::int2_array:
+            return oid::int2;
+          case oid::int4_array:
+            return oid::int4;
+          case oid::text_array:
+            return oid::text;
+          case oid::bpchar_array:
+            return oid::bpchar;
+          case oid::varchar_array:
+            return oid::varchar;
+          case oid::int8_array:
+            return oid::int8;
+          case oid::float4_array:
+            return oid::float4;
+          case oid::float8_array:
+            return oid::float8;
+          case oid::oid_array:
+            return oid::oid;
+          default:
+            return 0;
+        }
+      }
+
+      inline void write_uint16(char* data, uint16_t value)
+      {
+        data[0] = static_cast<char>(value >> 8);
+        data[1] = static_cast<char>(value);
+      }
+
+      inline void write_uint32(char* data, uint32_t value)
+      {
+        data[0] = static_cast<char>(value >> 24);
+        data[1] = static_cast<char>(value >> 16);
+        data[2] = static_cast<char>(value >> 8);
+        data[3] = static_cast<char>(value);
+      }
+
+      inline void write_uint64(char* data, uint64_t value)
+      {
+        write_uint32(data, static_cast<uint32_t>(value >> 32));
+        write_uint32(data + 4, static_cast<uint32_t>(value));
+      }
+
+      inline void write_float4(char* data, float value)
+      {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        write_uint32(data, bits);
+      }
+
+      inline void write_float8(char* data, double value)
+      {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        write_uint64(data, bits);
+      }
+
+      //! false if value is out of range for the integral type, which its binary representation would truncate
+      inline bool fits_integral_type(Oid type, int64_t value)
+      {
+        switch (type)
+        {
+          case oid::int2:
+            return value >= INT16_MIN && value <= INT16_MAX;
+          case oid::int4:
+            return value >= INT32_MIN && value <= INT32_MAX;
+          case oid::oid:
+            return value >= 0 && value <= static_cast<int64_t>(UINT32_MAX);
+          default:
+            return true;
+        }
+      }
+
+      //! Character types whose binary representation is the text itself
+      inline bool is_text_type(Oid type)
+      {
+        switch (type)
+        {
+          case oid::text:
+          case oid::varchar:
+          case oid::bpchar:
+          case oid::name:
+          case oid::character:
+          case oid::json:
+          case oid::xml:
+          case oid::unknown:
+          case oid::bytea:
+            return true;
+          default:
+            return false;
+        }
+      }
+
+    }
+  }
+}
+
+#endif
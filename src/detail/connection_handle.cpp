@@ -26,10 +26,12 @@
  */
 
 #include "connection_handle.h"
+#include "socket.h"
 
 #include <sqlpp11/postgresql/connection_config.h>
 #include <sqlpp11/exception.h>
 
+#include <algorithm>
 #include <iostream>  // DEBUG
 
 namespace sqlpp
@@ -38,128 +40,353 @@ namespace sqlpp
   {
     namespace detail
     {
-      connection_handle::connection_handle(const std::shared_ptr<connection_config>& conf) : config(conf)
+      server_statement_t::server_statement_t(connection_handle& _handle, std::string _name, std::string _sql)
+          : handle(&_handle), session(_handle.session), name(std::move(_name)), sql(std::move(_sql))
       {
-        if (config->debug)
+      }
+
+      server_statement_t::~server_statement_t()
+      {
+        // Queue a DEALLOCATE for this prepared statement, unless the server has forgotten it already
+        if (handle && handle->session == session)
         {
-          std::cerr << "PostgreSQL debug: connecting to the database server." << std::endl;
+          handle->deallocations.push_back("DEALLOCATE \"" + name + "\"");
         }
+      }
 
-        // Open connection
-        std::string conninfo = "";
-        if (!config->host.empty())
+      std::shared_ptr<server_statement_t> statement_cache_t::find(const std::string& stmt)
+      {
+        auto it = _index.find(stmt);
+        if (it == _index.end())
         {
-          conninfo.append("host=" + config->host);
+          ++misses;
+          return nullptr;
         }
-        if (!config->hostaddr.empty())
+
+        ++hits;
+        _entries.splice(_entries.begin(), _entries, it->second);
+        return it->second->second;
+      }
+
+      void statement_cache_t::insert(const std::string& stmt, const std::shared_ptr<server_statement_t>& statement)
+      {
+        if (_capacity == 0)
         {
-          conninfo.append(" hostaddr=" + config->hostaddr);
+          return;
         }
-        if (config->port != 5432)
+
+        if (_entries.size() >= _capacity)
         {
-          conninfo.append(" port=" + std::to_string(config->port));
+          // Evicting only drops the cache's reference, statements still in use
+          // by a prepared statement are DEALLOCATEd once that is destroyed.
+          _index.erase(_entries.back().first);
+          _entries.pop_back();
         }
-        if (!config->dbname.empty())
+        _entries.emplace_front(stmt, statement);
+        _index[stmt] = _entries.begin();
+      }
+
+      void statement_cache_t::clear(bool connection_lost)
+      {
+        if (connection_lost)
         {
-          conninfo.append(" dbname=" + config->dbname);
+          for (auto& entry : _entries)
+          {
+            entry.second->handle = nullptr;
+          }
         }
-        if (!config->user.empty())
+        _index.clear();
+        _entries.clear();
+      }
+
+      void connect_params_t::add(const char* keyword, std::string value)
+      {
+        _keywords.push_back(keyword);
+        _values.push_back(std::move(value));
+      }
+
+      const char* const* connect_params_t::keywords()
+      {
+        _keywordPointers.assign(_keywords.begin(), _keywords.end());
+        _keywordPointers.push_back(nullptr);
+        return _keywordPointers.data();
+      }
+
+      const char* const* connect_params_t::values()
+      {
+        _valuePointers.clear();
+        for (const auto& value : _values)
         {
-          conninfo.append(" user=" + config->user);
+          _valuePointers.push_back(value.c_str());
         }
-        if (!config->password.empty())
+        _valuePointers.push_back(nullptr);
+        return _valuePointers.data();
+      }
+
+      connect_params_t connect_params(const connection_config& config)
+      {
+        connect_params_t params;
+        if (!config.host.empty())
         {
-          conninfo.append(" password=" + config->password);
+          params.add("host", config.host);
         }
-        if (config->connect_timeout != 0)
+        if (!config.hostaddr.empty())
         {
-          conninfo.append(" connect_timeout=" + std::to_string(config->connect_timeout));
+          params.add("hostaddr", config.hostaddr);
         }
-        if (!config->client_encoding.empty())
+        if (config.port != 5432)
         {
-          conninfo.append(" client_encoding=" + config->client_encoding);
+          params.add("port", std::to_string(config.port));
         }
-        if (!config->options.empty())
+        if (!config.dbname.empty())
         {
-          conninfo.append(" options=" + config->options);
+          params.add("dbname", config.dbname);
         }
-        if (!config->application_name.empty())
+        if (!config.user.empty())
         {
-          conninfo.append(" application_name=" + config->application_name);
+          params.add("user", config.user);
         }
-        if (!config->fallback_application_name.empty())
+        if (!config.password.empty())
         {
-          conninfo.append(" fallback_application_name=" + config->fallback_application_name);
+          params.add("password", config.password);
         }
-        if (!config->keepalives)
+        if (config.connect_timeout != 0)
         {
-          conninfo.append(" keepalives=0");
+          params.add("connect_timeout", std::to_string(config.connect_timeout));
         }
-        if (config->keepalives_idle != 0)
+        if (!config.client_encoding.empty())
         {
-          conninfo.append(" keepalives_idle=" + std::to_string(config->keepalives_idle));
+          params.add("client_encoding", config.client_encoding);
         }
-        if (config->keepalives_interval != 0)
+        if (!config.options.empty())
         {
-          conninfo.append(" keepalives_interval=" + std::to_string(config->keepalives_interval));
+          params.add("options", config.options);
         }
-        if (config->keepalives_count != 0)
+        if (!config.application_name.empty())
         {
-          conninfo.append(" keepalives_count=" + std::to_string(config->keepalives_count));
+          params.add("application_name", config.application_name);
         }
-        switch (config->sslmode)
+        if (!config.fallback_application_name.empty())
+        {
+          params.add("fallback_application_name", config.fallback_application_name);
+        }
+        if (!config.keepalives)
+        {
+          params.add("keepalives", "0");
+        }
+        if (config.keepalives_idle != 0)
+        {
+          params.add("keepalives_idle", std::to_string(config.keepalives_idle));
+        }
+        if (config.keepalives_interval != 0)
+        {
+          params.add("keepalives_interval", std::to_string(config.keepalives_interval));
+        }
+        if (config.keepalives_count != 0)
+        {
+          params.add("keepalives_count", std::to_string(config.keepalives_count));
+        }
+        switch (config.sslmode)
         {
           case connection_config::sslmode_t::disable:
-            conninfo.append(" sslmode=disable");
+            params.add("sslmode", "disable");
             break;
           case connection_config::sslmode_t::allow:
-            conninfo.append(" sslmode=allow");
+            params.add("sslmode", "allow");
             break;
           case connection_config::sslmode_t::require:
-            conninfo.append(" sslmode=require");
+            params.add("sslmode", "require");
             break;
           case connection_config::sslmode_t::verify_ca:
-            conninfo.append(" sslmode=verify-ca");
+            params.add("sslmode", "verify-ca");
             break;
           case connection_config::sslmode_t::verify_full:
-            conninfo.append(" sslmode=verify-full");
+            params.add("sslmode", "verify-full");
             break;
           case connection_config::sslmode_t::prefer:
           default:
             break;
         }
-        if (!config->sslcompression)
+        if (!config.sslcompression)
+        {
+          params.add("sslcompression", "0");
+        }
+        if (!config.sslcert.empty())
         {
-          conninfo.append(" sslcompression=0");
+          params.add("sslcert", config.sslcert);
         }
-        if (!config->sslcert.empty())
+        if (!config.sslkey.empty())
         {
-          conninfo.append(" sslcert=" + config->sslcert);
+          params.add("sslkey", config.sslkey);
         }
-        if (!config->sslkey.empty())
+        if (!config.sslrootcert.empty())
         {
-          conninfo.append(" sslkey=" + config->sslkey);
+          params.add("sslrootcert", config.sslrootcert);
         }
-        if (!config->sslrootcert.empty())
+        if (!config.sslcrl.empty())
         {
-          conninfo.append(" sslrootcert=" + config->sslrootcert);
+          params.add("sslcrl", config.sslcrl);
         }
-        if (!config->requirepeer.empty())
+        if (!config.requirepeer.empty())
         {
-          conninfo.append(" requirepeer=" + config->requirepeer);
+          params.add("requirepeer", config.requirepeer);
         }
-        if (!config->krbsrvname.empty())
+        if (!config.krbsrvname.empty())
         {
-          conninfo.append(" krbsrvname=" + config->krbsrvname);
+          params.add("krbsrvname", config.krbsrvname);
         }
-        if (!config->service.empty())
+        if (!config.service.empty())
         {
-          conninfo.append(" service=" + config->service);
+          params.add("service", config.service);
         }
-        this->postgres = PQconnectdb(conninfo.c_str());
-        if (PQstatus(this->postgres) != CONNECTION_OK)
+        if (!config.target_session_attrs.empty())
         {
-          throw sqlpp::exception("PostgreSQL error: failed to connect to the database");
+          params.add("target_session_attrs", config.target_session_attrs);
+        }
+        if (config.load_balance_hosts)
+        {
+          params.add("load_balance_hosts", "random");
+        }
+        return params;
+      }
+
+      connection_handle::connection_handle(const std::shared_ptr<connection_config>& conf)
+          : connection_handle(conf, deferred_connect)
+      {
+        // Once the delegated constructor returned, the destructor cleans up if connecting fails
+        const auto deadline = connect_deadline();
+        do
+        {
+          connect_wait(deadline);
+        } while (connect_poll() != PGRES_POLLING_OK);
+      }
+
+      connection_handle::connection_handle(const std::shared_ptr<connection_config>& conf, deferred_connect_t)
+          : config(conf), statement_cache(conf->statement_cache_size), statement_timeout(conf->statement_timeout)
+      {
+        if (config->debug)
+        {
+          std::cerr << "PostgreSQL debug: connecting to the database server." << std::endl;
+        }
+
+        connect_params_t params = connect_params(*config);
+        _connectStarted = clock_t::now();
+        _phaseStarted = _connectStarted;
+        // Host names are resolved while starting, the first phase is accounted as dns
+        postgres = PQconnectStartParams(params.keywords(), params.values(), 0);
+        if (!postgres)
+        {
+          throw sqlpp::exception("PostgreSQL error: failed to connect to the database: out of memory");
+        }
+        account_phase(connect_phase_t::dns);
+        if (PQstatus(postgres) == CONNECTION_BAD)
+        {
+          std::string error = PQerrorMessage(postgres);
+          PQfinish(postgres);
+          throw sqlpp::exception("PostgreSQL error: failed to connect to the database: " + error);
+        }
+      }
+
+      connection_handle::clock_t::time_point connection_handle::connect_deadline() const
+      {
+        if (config->connect_timeout == 0)
+        {
+          return clock_t::time_point::max();
+        }
+        // libpq does not enforce connect_timeout for non-blocking connects
+        return _connectStarted + std::chrono::seconds(config->connect_timeout);
+      }
+
+      void connection_handle::account_phase(connect_phase_t phase)
+      {
+        const auto now = clock_t::now();
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - _phaseStarted);
+        switch (phase)
+        {
+          case connect_phase_t::dns:
+            timings.dns += elapsed;
+            break;
+          case connect_phase_t::tcp:
+            timings.tcp += elapsed;
+            break;
+          case connect_phase_t::tls:
+            timings.tls += elapsed;
+            break;
+          case connect_phase_t::auth:
+            timings.auth += elapsed;
+            break;
+        }
+        timings.total = std::chrono::duration_cast<std::chrono::microseconds>(now - _connectStarted);
+        _phaseStarted = now;
+      }
+
+      PostgresPollingStatusType connection_handle::connect_poll()
+      {
+        // The time since the last poll is spent in the phase the connection was in
+        connect_phase_t phase;
+        switch (PQstatus(postgres))
+        {
+          case CONNECTION_NEEDED:
+          case CONNECTION_STARTED:
+            phase = connect_phase_t::tcp;
+            break;
+          case CONNECTION_SSL_STARTUP:
+            phase = connect_phase_t::tls;
+            break;
+          default:
+            phase = connect_phase_t::auth;
+            break;
+        }
+
+        _pollStatus = PQconnectPoll(postgres);
+        account_phase(phase);
+        if (_pollStatus == PGRES_POLLING_FAILED)
+        {
+          throw sqlpp::exception("PostgreSQL error: failed to connect to the database: " +
+                                 std::string(PQerrorMessage(postgres)));
+        }
+        if (_pollStatus == PGRES_POLLING_OK)
+        {
+          renew_cancel_token();
+        }
+        if (_pollStatus == PGRES_POLLING_OK && config->debug)
+        {
+          std::cerr << "PostgreSQL debug: connected in " << timings.total.count() << "us (dns "
+                    << timings.dns.count() << "us, tcp " << timings.tcp.count() << "us, tls " << timings.tls.count()
+                    << "us, auth " << timings.auth.count() << "us)" << std::endl;
+        }
+        return _pollStatus;
+      }
+
+      bool connection_handle::connect_wants_write() const
+      {
+        return _pollStatus == PGRES_POLLING_WRITING;
+      }
+
+      int connection_handle::timeout_until(clock_t::time_point deadline)
+      {
+        if (deadline == clock_t::time_point::max())
+        {
+          return -1;
+        }
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock_t::now());
+        return static_cast<int>(std::max<std::chrono::milliseconds::rep>(left.count(), 0));
+      }
+
+      void connection_handle::renew_cancel_token()
+      {
+        if (cancel_token)
+        {
+          PQfreeCancel(cancel_token);
+        }
+        cancel_token = PQgetCancel(postgres);
+      }
+
+      void connection_handle::connect_wait(clock_t::time_point deadline)
+      {
+        if (!wait_socket(postgres, !connect_wants_write(), connect_wants_write(), timeout_until(deadline)))
+        {
+          throw sqlpp::exception("PostgreSQL error: failed to connect to the database: timeout expired");
         }
       }
 
@@ -171,6 +398,14 @@ namespace sqlpp
           std::cerr << "PostgreSQL debug: closing database connection." << std::endl;
         }
 
+        // The server drops all prepared statements when the connection is closed
+        statement_cache.clear(true);
+
+        if (cancel_token)
+        {
+          PQfreeCancel(cancel_token);
+        }
+
         // Close connection
         if (this->postgres)
         {
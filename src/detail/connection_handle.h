@@ -28,32 +28,213 @@
 #ifndef SQLPP_POSTGRESQL_CONNECTION_HANDLE_H
 #define SQLPP_POSTGRESQL_CONNECTION_HANDLE_H
 
+#include <chrono>
+#include <list>
+#include <map>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <libpq-fe.h>
 
+#include <sqlpp11/postgresql/connection_config.h>
+#include <sqlpp11/postgresql/notification.h>
+
 namespace sqlpp
 {
   namespace postgresql
   {
-    // Forward declaration
-    struct connection_config;
-
     namespace detail
     {
+      struct connection_handle;
+      struct result_handle_t;
+
+      // A named statement prepared on the server. The statement is DEALLOCATEd
+      // when the last prepared_statement_handle_t using it is gone and it has
+      // been evicted from the statement cache (or was never cached). The
+      // DEALLOCATE is queued and goes out with the next statement, sending it
+      // right away could interrupt a streamed result.
+      struct server_statement_t
+      {
+        connection_handle* handle{nullptr};
+        // The connection_handle::session the statement was prepared in
+        uint64_t session{0};
+        std::string name;
+        // The SQL text, as reported to the instrumentation
+        std::string sql;
+        // Parameter types as inferred by the server, only described when binary
+        // parameters are enabled.
+        std::vector<Oid> param_types;
+
+        server_statement_t(connection_handle& _handle, std::string _name, std::string _sql);
+        ~server_statement_t();
+        server_statement_t(const server_statement_t&) = delete;
+        server_statement_t(server_statement_t&&) = delete;
+        server_statement_t& operator=(const server_statement_t&) = delete;
+        server_statement_t& operator=(server_statement_t&&) = delete;
+      };
+
+      // Bounded LRU cache of server side statements keyed by their SQL text.
+      class statement_cache_t
+      {
+        using entry_t = std::pair<std::string, std::shared_ptr<server_statement_t>>;
+
+        std::list<entry_t> _entries;  // most recently used first
+        std::unordered_map<std::string, std::list<entry_t>::iterator> _index;
+        size_t _capacity;
+
+      public:
+        size_t hits{0};
+        size_t misses{0};
+
+        statement_cache_t(size_t capacity) : _capacity(capacity)
+        {
+        }
+
+        //! Returns the cached statement for the SQL text or nullptr, counting a hit or a miss.
+        std::shared_ptr<server_statement_t> find(const std::string& stmt);
+
+        //! Adds a statement, evicting the least recently used one if the cache is full.
+        void insert(const std::string& stmt, const std::shared_ptr<server_statement_t>& statement);
+
+        //! Drops all entries. If connection_lost is set, the statements are not DEALLOCATEd.
+        void clear(bool connection_lost);
+
+        size_t size() const
+        {
+          return _entries.size();
+        }
+
+        size_t capacity() const
+        {
+          return _capacity;
+        }
+      };
+
+      // Keyword/value arrays for PQconnectStartParams built from a connection_config
+      class connect_params_t
+      {
+        std::vector<const char*> _keywords;
+        std::vector<std::string> _values;
+        std::vector<const char*> _keywordPointers;
+        std::vector<const char*> _valuePointers;
+
+      public:
+        void add(const char* keyword, std::string value);
+        //! null terminated arrays, valid while this object is neither modified nor destroyed
+        const char* const* keywords();
+        const char* const* values();
+      };
+
+      connect_params_t connect_params(const connection_config& config);
+
+      struct deferred_connect_t
+      {
+      };
+      constexpr deferred_connect_t deferred_connect{};
+
       struct connection_handle
       {
+        using clock_t = std::chrono::steady_clock;
+
         const std::shared_ptr<connection_config> config;
         PGconn* postgres{nullptr};
-        std::vector<std::string> prepared_statement_names;
+        statement_cache_t statement_cache;
+        uint64_t statement_counter{0};
+        // Incremented whenever the connection is reset, the server forgets statements and cursors then
+        uint64_t session{0};
+        // Incremented whenever a transaction starts or ends
+        uint64_t transaction_counter{0};
+        // Deferred transaction control commands (BEGIN, SAVEPOINT, ...), sent
+        // together with the next statement
+        std::vector<std::string> prologue;
+        // DEALLOCATEs of destroyed statements, added to the prologue unless the transaction is aborted
+        std::vector<std::string> deallocations;
+        // The transaction's BEGIN is still in the prologue
+        bool begin_deferred{false};
+        // The deferred BEGIN failed or was skipped, or a pipeline statement aborted the transaction.
+        // Statements throw until it is rolled back, a commit throws.
+        bool transaction_failed{false};
+        // A pipeline_t is open, only it may send statements
+        bool pipeline_active{false};
+        // Savepoints of the open transaction, with the statement_counter at their creation
+        std::vector<std::pair<std::string, uint64_t>> savepoints;
+        // Ranges (first, last] of statement_counter values whose cursors rolling back to a savepoint destroyed
+        std::vector<std::pair<uint64_t, uint64_t>> dropped_cursors;
+        // An asynchronous statement is in flight, synchronous calls would make libpq discard its result
+        bool async_pending{false};
+        // The streaming result whose rows are still arriving, executing anything else abandons it
+        result_handle_t* active_stream{nullptr};
+        // LISTEN subscriptions by id, as channel and callback
+        std::map<size_t, std::pair<std::string, notification_callback_t>> subscriptions;
+        size_t subscription_counter{0};
+        // Deadline of the statements executed, 0 for none
+        std::chrono::milliseconds statement_timeout;
+        // The statement_timeout the session has been set to in ms, 0 for the
+        // server default and -1 if unknown, e.g. after the SET was rolled back
+        int64_t session_timeout{0};
+        // Cancels the statement in progress, belongs to the connected session
+        PGcancel* cancel_token{nullptr};
 
+        connect_timings_t timings;
+
+        //! connects, blocking until the connection is established or has failed
         connection_handle(const std::shared_ptr<connection_config>& config);
+        //! only starts connecting, the connection has to be completed by calling connect_poll()
+        // until it returns PGRES_POLLING_OK, waiting for the socket in between
+        connection_handle(const std::shared_ptr<connection_config>& config, deferred_connect_t);
         ~connection_handle();
         connection_handle(const connection_handle&) = delete;
         connection_handle(connection_handle&&) = delete;
         connection_handle& operator=(const connection_handle&) = delete;
         connection_handle& operator=(connection_handle&&) = delete;
+
+        //! Advances a deferred connect, throws if connecting failed
+        PostgresPollingStatusType connect_poll();
+        //! true if the next connect_poll() waits for the socket to become writable rather than readable
+        bool connect_wants_write() const;
+        //! waits until the socket is ready for the next connect_poll(), throws on timeout
+        void connect_wait(clock_t::time_point deadline);
+        //! the point in time connect_timeout expires, or time_point::max()
+        clock_t::time_point connect_deadline() const;
+        //! milliseconds left until deadline as expected by poll, -1 for time_point::max()
+        static int timeout_until(clock_t::time_point deadline);
+        //! replaces the cancel token by one for the current session, after connecting or resetting
+        void renew_cancel_token();
+
+        //! Returns a new statement name, unique for this connection.
+        std::string next_statement_name()
+        {
+          return "sqlpp_" + std::to_string(++statement_counter);
+        }
+
+        //! Returns a new cursor name, unique for this connection.
+        std::string next_cursor_name()
+        {
+          return "sqlpp_cursor_" + std::to_string(++statement_counter);
+        }
+
+        //! Returns a new savepoint name, unique for this connection.
+        std::string next_savepoint_name()
+        {
+          return "sqlpp_savepoint_" + std::to_string(++statement_counter);
+        }
+
+      private:
+        enum class connect_phase_t
+        {
+          dns,
+          tcp,
+          tls,
+          auth
+        };
+
+        clock_t::time_point _connectStarted;
+        clock_t::time_point _phaseStarted;
+        PostgresPollingStatusType _pollStatus{PGRES_POLLING_WRITING};
+
+        void account_phase(connect_phase_t phase);
       };
     }
   }
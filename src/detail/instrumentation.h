@@ -0,0 +1,98 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_DETAIL_INSTRUMENTATION_H
+#define SQLPP_POSTGRESQL_DETAIL_INSTRUMENTATION_H
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+
+#include <libpq-fe.h>
+
+#include <sqlpp11/postgresql/instrumentation.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    namespace detail
+    {
+      using instrumentation_clock_t = std::chrono::steady_clock;
+
+      //! The instrumentation to call, a constant nullptr if instrumentation is compiled out
+      inline instrumentation_t* instrumentation(const std::shared_ptr<instrumentation_t>& configured)
+      {
+#ifdef SQLPP_POSTGRESQL_NO_INSTRUMENTATION
+        (void)configured;
+        return nullptr;
+#else
+        return configured.get();
+#endif
+      }
+
+      //! Reads the clock only if there is someone to report to
+      inline instrumentation_clock_t::time_point start_timer(const instrumentation_t* instrumentation)
+      {
+        return instrumentation ? instrumentation_clock_t::now() : instrumentation_clock_t::time_point{};
+      }
+
+      inline std::chrono::nanoseconds elapsed_since(instrumentation_clock_t::time_point start)
+      {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(instrumentation_clock_t::now() - start);
+      }
+
+      //! Rows returned, or affected if the statement returned none
+      inline size_t result_rows(const PGresult* result)
+      {
+        if (PQresultStatus(result) == PGRES_COMMAND_OK)
+        {
+          return std::strtoull(PQcmdTuples(const_cast<PGresult*>(result)), nullptr, 10);
+        }
+        return static_cast<size_t>(PQntuples(result));
+      }
+
+      //! Size of the values in a result
+      inline size_t result_bytes(const PGresult* result)
+      {
+        size_t bytes = 0;
+        const int rows = PQntuples(result);
+        const int fields = PQnfields(result);
+        for (int row = 0; row < rows; ++row)
+        {
+          for (int field = 0; field < fields; ++field)
+          {
+            bytes += static_cast<size_t>(PQgetlength(result, row, field));
+          }
+        }
+        return bytes;
+      }
+    }
+  }
+}
+
+#endif
@@ -28,63 +28,115 @@
 #ifndef SQLPP_POSTGRESQL_PREPARED_STATEMENT_HANDLE_H
 #define SQLPP_POSTGRESQL_PREPARED_STATEMENT_HANDLE_H
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
 
 #include <libpq-fe.h>
 
+#include "result_handle.h"
+
 namespace sqlpp
 {
   namespace postgresql
   {
     namespace detail
     {
-      struct prepared_statement_handle_t
+      struct server_statement_t;
+
+      // A prepared statement with its parameters. It inherits the state of the
+      // result it was executed into last, see result_handle_t.
+      struct prepared_statement_handle_t : result_handle_t
       {
-        PGconn* connection{nullptr};
-        PGresult* result{nullptr};
-        std::string name{"xxxxxx"};
+        std::shared_ptr<server_statement_t> statement;
         bool valid{false};
-        bool debug{false};
-        uint32_t count{0};
-        uint32_t totalCount = {0};
-        uint32_t fields = {0};
 
-        // Store prepared statement arguments
+        // Prepared statement arguments live in one flat buffer that is sized at
+        // prepare time and rewound before every round of binding, so executing
+        // a prepared statement repeatedly does not allocate. Only a text
+        // parameter longer than any bound before grows the buffer.
+        std::vector<char> paramBuffer;
+        size_t paramBufferUsed{0};
+        std::vector<size_t> paramOffsets;
+        std::vector<int> paramLengths;
+        std::vector<int> paramFormats;
         std::vector<bool> nullValues;
-        std::vector<std::string> paramValues;
+        std::vector<const char*> paramValues;
+        // Server side parameter types, empty if parameters are sent as text
+        std::vector<Oid> paramTypes;
 
         // ctor
 		prepared_statement_handle_t(PGconn* _connection, const size_t& paramCount, bool _debug)
-            : connection(_connection), debug(_debug), nullValues(paramCount), paramValues(paramCount)
+            : result_handle_t(_connection, _debug),
+              paramBuffer(paramCount * 16),
+              paramOffsets(paramCount),
+              paramLengths(paramCount),
+              paramFormats(paramCount),
+              nullValues(paramCount, true),
+              paramValues(paramCount)
         {
         }
-        prepared_statement_handle_t(const prepared_statement_handle_t&) = delete;
-        prepared_statement_handle_t(prepared_statement_handle_t&&) = default;
-        prepared_statement_handle_t& operator=(const prepared_statement_handle_t&) = delete;
-        prepared_statement_handle_t& operator=(prepared_statement_handle_t&&) = default;
 
-        ~prepared_statement_handle_t()
+        size_t param_count() const
         {
-          // Clear the result
-          if (result)
+          return paramOffsets.size();
+        }
+
+        //! Rewinds the parameter buffer, previously bound values are discarded.
+        void reset_params()
+        {
+          paramBufferUsed = 0;
+        }
+
+        //! Reserves length bytes for the parameter at index and returns where to write them.
+        char* param_storage(size_t index, size_t length, int format)
+        {
+          if (paramBufferUsed + length > paramBuffer.size())
           {
-            PQclear(result);
+            paramBuffer.resize(std::max(paramBuffer.size() * 2, paramBufferUsed + length));
           }
+          paramOffsets[index] = paramBufferUsed;
+          paramLengths[index] = static_cast<int>(length);
+          paramFormats[index] = format;
+          nullValues[index] = false;
+          paramBufferUsed += length;
+          return paramBuffer.data() + paramOffsets[index];
+        }
 
-          // Execute DEALLOCATE on the connection_handle for this
-          // prepared statement.
-          if (valid && !name.empty())
+        void set_param_null(size_t index)
+        {
+          nullValues[index] = true;
+        }
+
+        //! Rewinds the parameter buffer and sets all parameters to null.
+        void clear_params()
+        {
+          reset_params();
+          std::fill(nullValues.begin(), nullValues.end(), true);
+        }
+
+        //! Returns the parameter values as expected by PQexecPrepared.
+        const char* const* param_values()
+        {
+          // Pointers are resolved only now, binding may have moved the buffer
+          for (size_t i = 0; i < param_count(); ++i)
           {
-            std::string cmd = "DEALLOCATE \"" + name + "\"";
-            PGresult* result = PQexec(connection, cmd.c_str());
-            PQclear(result);
+            paramValues[i] = nullValues[i] ? nullptr : paramBuffer.data() + paramOffsets[i];
           }
+          return paramValues.data();
+        }
 
-          // TODO: remove the name from the prepared_statement_names
-          // in the connection_handle.
+        //! Returns the server side type of the parameter, or 0 if unknown.
+        Oid param_type(size_t index) const
+        {
+          return index < paramTypes.size() ? paramTypes[index] : 0;
         }
+        prepared_statement_handle_t(const prepared_statement_handle_t&) = delete;
+        prepared_statement_handle_t(prepared_statement_handle_t&&) = delete;
+        prepared_statement_handle_t& operator=(const prepared_statement_handle_t&) = delete;
+        prepared_statement_handle_t& operator=(prepared_statement_handle_t&&) = delete;
 
         bool operator!() const
         {
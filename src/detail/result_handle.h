@@ -0,0 +1,265 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef SQLPP_POSTGRESQL_RESULT_HANDLE_H
+#define SQLPP_POSTGRESQL_RESULT_HANDLE_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libpq-fe.h>
+
+#include <sqlpp11/postgresql/instrumentation.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    namespace detail
+    {
+      // How bind_result_t obtains the rows of a result
+      enum class fetch_mode_t
+      {
+        materialized,  // the whole result is in one PGresult
+        streaming,     // rows are pulled from the connection in single row or chunked mode
+        cursor         // rows are FETCHed in batches from a server side cursor
+      };
+
+      // The rows of one execution and the position reached in them. A result
+      // is received into the statement that was executed and a select moves it
+      // out into its bind_result_t with take(), so the statement can run again
+      // while earlier results are still being read. Materialized results are
+      // independent of the connection then, streaming and cursor results keep
+      // pulling their rows from it.
+      struct result_handle_t
+      {
+        PGconn* connection{nullptr};
+        PGresult* result{nullptr};
+        // Owns result once it has been pinned, see pin_result()
+        std::shared_ptr<PGresult> pinnedResult;
+        bool debug{false};
+        uint32_t count{0};
+        uint32_t totalCount = {0};
+        uint32_t fields = {0};
+        fetch_mode_t mode{fetch_mode_t::materialized};
+        // Set while a streamed result still has results pending on the connection
+        bool streaming{false};
+        // While streaming, the connection's record of its active stream, which points back to this result
+        result_handle_t** activeStream{nullptr};
+        // An abandoned stream outside of a transaction is cancelled instead of being read to its end
+        bool cancelOnAbandon{false};
+        // Server side cursor, declared inside the transaction counted as cursorTransaction
+        std::string cursor;
+        size_t fetchSize{0};
+        int resultFormat{0};
+        bool cursorExhausted{false};
+        const uint64_t* transactionCounter{nullptr};
+        uint64_t cursorTransaction{0};
+        // The connection's statement_counter when the cursor was declared, and the
+        // ranges of it whose cursors a rollback to a savepoint destroyed
+        uint64_t cursorSequence{0};
+        const std::vector<std::pair<uint64_t, uint64_t>>* droppedCursors{nullptr};
+        // The connection's active stream, finished before a FETCH, and its deferred commands, which CLOSE joins
+        result_handle_t** connectionStream{nullptr};
+        std::vector<std::string>* deferredCommands{nullptr};
+        // Set while an asynchronous statement is in flight on the connection, a FETCH would discard its result
+        const bool* asyncPending{nullptr};
+        // Set while a pipeline is open on the connection, a FETCH would be mixed up with its statements
+        const bool* pipelineActive{nullptr};
+        // Told about the batches of streaming and cursor selects
+        std::shared_ptr<instrumentation_t> instrumentation;
+
+        result_handle_t(PGconn* _connection, bool _debug) : connection(_connection), debug(_debug)
+        {
+        }
+        result_handle_t(const result_handle_t&) = delete;
+        result_handle_t(result_handle_t&&) = delete;
+        result_handle_t& operator=(const result_handle_t&) = delete;
+        result_handle_t& operator=(result_handle_t&&) = delete;
+
+        ~result_handle_t()
+        {
+          finish_streaming();
+          close_cursor();
+          release_result();
+        }
+
+        //! Moves the result and the position in it into a new handle, leaving this one without a result.
+        std::unique_ptr<result_handle_t> take()
+        {
+          std::unique_ptr<result_handle_t> taken(new result_handle_t(connection, debug));
+          std::swap(result, taken->result);
+          std::swap(pinnedResult, taken->pinnedResult);
+          std::swap(count, taken->count);
+          std::swap(totalCount, taken->totalCount);
+          std::swap(fields, taken->fields);
+          std::swap(mode, taken->mode);
+          std::swap(streaming, taken->streaming);
+          std::swap(activeStream, taken->activeStream);
+          std::swap(cancelOnAbandon, taken->cancelOnAbandon);
+          std::swap(cursor, taken->cursor);
+          std::swap(fetchSize, taken->fetchSize);
+          std::swap(resultFormat, taken->resultFormat);
+          std::swap(cursorExhausted, taken->cursorExhausted);
+          std::swap(transactionCounter, taken->transactionCounter);
+          std::swap(cursorTransaction, taken->cursorTransaction);
+          std::swap(cursorSequence, taken->cursorSequence);
+          std::swap(droppedCursors, taken->droppedCursors);
+          std::swap(connectionStream, taken->connectionStream);
+          std::swap(deferredCommands, taken->deferredCommands);
+          std::swap(asyncPending, taken->asyncPending);
+          std::swap(pipelineActive, taken->pipelineActive);
+          std::swap(instrumentation, taken->instrumentation);
+          if (taken->activeStream)
+          {
+            *taken->activeStream = taken.get();
+          }
+          return taken;
+        }
+
+        //! Frees the current result, a pinned result is freed once its last pin is gone.
+        void release_result()
+        {
+          if (result && pinnedResult.get() != result)
+          {
+            PQclear(result);
+          }
+          pinnedResult.reset();
+          result = nullptr;
+        }
+
+        //! Shares ownership of the current result, so that it outlives the next execution or batch.
+        std::shared_ptr<PGresult> pin_result()
+        {
+          if (result && pinnedResult.get() != result)
+          {
+            pinnedResult = std::shared_ptr<PGresult>(result, PQclear);
+          }
+          return pinnedResult;
+        }
+
+        //! Registers this result as the connection's active stream
+        void start_stream(result_handle_t** active)
+        {
+          streaming = true;
+          activeStream = active;
+          *activeStream = this;
+        }
+
+        //! All results of the stream have been received
+        void end_stream()
+        {
+          streaming = false;
+          if (activeStream && *activeStream == this)
+          {
+            *activeStream = nullptr;
+          }
+          activeStream = nullptr;
+        }
+
+        //! Abandons a streamed result, the connection cannot be used before all rows are consumed.
+        void finish_streaming()
+        {
+          if (!streaming)
+          {
+            return;
+          }
+
+          // Discard the rows that have arrived already, the statement may have completed meanwhile
+          bool running = true;
+          PQconsumeInput(connection);
+          while (running && !PQisBusy(connection))
+          {
+            PGresult* pending = PQgetResult(connection);
+            running = pending != nullptr;
+            PQclear(pending);
+          }
+
+          // Ask the server to stop sending rows, unless that would fail the surrounding transaction
+          // or the statement is done and the cancel could hit the next one. Then discard the rest.
+          if (running && cancelOnAbandon)
+          {
+            PGcancel* cancel = PQgetCancel(connection);
+            if (cancel)
+            {
+              char errbuf[256];
+              PQcancel(cancel, errbuf, sizeof(errbuf));
+              PQfreeCancel(cancel);
+            }
+          }
+          while (running)
+          {
+            PGresult* pending = PQgetResult(connection);
+            running = pending != nullptr;
+            PQclear(pending);
+          }
+          end_stream();
+        }
+
+        //! Abandons the stream on the connection, whose remaining rows libpq would discard otherwise
+        void finish_connection_stream()
+        {
+          if (connectionStream && *connectionStream)
+          {
+            (*connectionStream)->finish_streaming();
+          }
+        }
+
+        //! Closes the cursor with the next statement, unless the transaction it belongs to has already ended,
+        // has been aborted or a rollback to a savepoint created before it has destroyed it. CLOSE fails then
+        // and would abort the transaction or the ROLLBACK TO SAVEPOINT sent with it.
+        void close_cursor()
+        {
+          if (cursor.empty())
+          {
+            return;
+          }
+
+          bool dropped = false;
+          if (droppedCursors)
+          {
+            for (const auto& range : *droppedCursors)
+            {
+              dropped = dropped || (range.first < cursorSequence && cursorSequence <= range.second);
+            }
+          }
+          if (transactionCounter && *transactionCounter == cursorTransaction && !dropped && deferredCommands &&
+              PQtransactionStatus(connection) != PQTRANS_INERROR)
+          {
+            deferredCommands->push_back("CLOSE \"" + cursor + "\"");
+          }
+          cursor.clear();
+        }
+      };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SQLPP_POSTGRESQL_SOCKET_H
+#define SQLPP_POSTGRESQL_SOCKET_H
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <winsock2.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#endif
+
+#include <libpq-fe.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    namespace detail
+    {
+#if defined(_WIN32) || defined(_WIN64)
+      using pollfd_t = WSAPOLLFD;
+#else
+      using pollfd_t = pollfd;
+#endif
+
+      inline pollfd_t make_pollfd(PGconn* connection, bool read, bool write)
+      {
+        pollfd_t fd;
+#if defined(_WIN32) || defined(_WIN64)
+        fd.fd = static_cast<SOCKET>(PQsocket(connection));
+#else
+        fd.fd = PQsocket(connection);
+#endif
+        fd.events = static_cast<short>((read ? POLLIN : 0) | (write ? POLLOUT : 0));
+        fd.revents = 0;
+        return fd;
+      }
+
+      //! Waits for any of several sockets, returns the number of ready ones or 0 on timeout.
+      // A negative timeout waits indefinitely.
+      inline int poll_sockets(pollfd_t* fds, size_t count, int timeout_ms)
+      {
+#if defined(_WIN32) || defined(_WIN64)
+        return WSAPoll(fds, static_cast<ULONG>(count), timeout_ms);
+#else
+        int ret;
+        do
+        {
+          ret = poll(fds, static_cast<nfds_t>(count), timeout_ms);
+        } while (ret < 0 && errno == EINTR);
+        return ret;
+#endif
+      }
+
+      //! Waits until the connection's socket is readable and/or writable.
+      // Returns false on timeout, a negative timeout waits indefinitely.
+      inline bool wait_socket(PGconn* connection, bool read, bool write, int timeout_ms)
+      {
+        pollfd_t fd = make_pollfd(connection, read, write);
+        return poll_sockets(&fd, 1, timeout_ms) > 0;
+      }
+
+      //! Sends all queued output of a non-blocking connection, reading input while
+      // waiting so that the server is never blocked on a full send buffer.
+      inline bool flush_nonblocking(PGconn* connection)
+      {
+        int ret;
+        while ((ret = PQflush(connection)) == 1)
+        {
+          wait_socket(connection, true, true, -1);
+          if (!PQconsumeInput(connection))
+          {
+            return false;
+          }
+        }
+        return ret == 0;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sqlpp11/postgresql/numeric_format.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <locale.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    namespace detail
+    {
+      namespace
+      {
+#ifdef _WIN32
+        _locale_t c_locale()
+        {
+          static const _locale_t locale = _create_locale(LC_NUMERIC, "C");
+          return locale;
+        }
+#else
+        locale_t c_locale()
+        {
+          static const locale_t locale = newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+          return locale;
+        }
+
+        // Switches the calling thread to the "C" locale for its lifetime
+        class scoped_c_locale_t
+        {
+        private:
+          locale_t _previous;
+
+        public:
+          scoped_c_locale_t() : _previous(uselocale(c_locale()))
+          {
+          }
+          scoped_c_locale_t(const scoped_c_locale_t&) = delete;
+          scoped_c_locale_t& operator=(const scoped_c_locale_t&) = delete;
+          ~scoped_c_locale_t()
+          {
+            uselocale(_previous);
+          }
+        };
+#endif
+      }
+
+      double parse_double(const char* text)
+      {
+#ifdef _WIN32
+        return _strtod_l(text, nullptr, c_locale());
+#else
+        scoped_c_locale_t c;
+        return std::strtod(text, nullptr);
+#endif
+      }
+
+      int format_double(char* data, size_t size, const char* format, double value)
+      {
+#ifdef _WIN32
+        return _snprintf_l(data, size, format, c_locale(), value);
+#else
+        scoped_c_locale_t c;
+        return std::snprintf(data, size, format, value);
+#endif
+      }
+    }
+  }
+}
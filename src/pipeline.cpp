@@ -0,0 +1,220 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sqlpp11/postgresql/pipeline.h>
+#include <sqlpp11/exception.h>
+
+#include <cstdlib>
+#include <iostream>
+
+#include "detail/connection_handle.h"
+#include "detail/prepared_statement_handle.h"
+#include "detail/socket.h"
+#include <sqlpp11/postgresql/connection_config.h>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+#ifdef LIBPQ_HAS_PIPELINING
+    pipeline_t::pipeline_t(connection& db, detail::connection_handle& handle, bool transaction_active)
+        : _db(&db), _handle(&handle), _transaction_active(transaction_active)
+    {
+      if (!PQenterPipelineMode(_handle->postgres))
+      {
+        throw sqlpp::exception("PostgreSQL error: cannot enter pipeline mode: " +
+                               std::string(PQerrorMessage(_handle->postgres)));
+      }
+      // Sending never blocks, so a large pipeline cannot dead-lock against the server's results
+      PQsetnonblocking(_handle->postgres, 1);
+      _handle->pipeline_active = true;
+    }
+
+    pipeline_t::pipeline_t(pipeline_t&& other)
+        : _db(other._db), _handle(other._handle), _queued(other._queued), _transaction_active(other._transaction_active)
+    {
+      other._handle = nullptr;
+    }
+
+    pipeline_t::~pipeline_t()
+    {
+      if (!_handle)
+      {
+        return;
+      }
+
+      try
+      {
+        if (_queued > 0)
+        {
+          sync();
+        }
+      }
+      catch (const sqlpp::exception& e)
+      {
+        std::cerr << "PostgreSQL error: " << e.what() << std::endl;
+      }
+      PQexitPipelineMode(_handle->postgres);
+      PQsetnonblocking(_handle->postgres, 0);
+      _handle->pipeline_active = false;
+    }
+
+    void pipeline_t::queue_prepared(prepared_statement_t& prep)
+    {
+      detail::prepared_statement_handle_t& prepared = *prep._handle;
+      if (_handle->config->debug)
+      {
+        std::cerr << "PostgreSQL debug: queueing prepared statement " << prepared.statement->name << std::endl;
+      }
+
+      if (!PQsendQueryPrepared(_handle->postgres, prepared.statement->name.c_str(), prepared.param_count(),
+                               prepared.param_values(), prepared.paramLengths.data(), prepared.paramFormats.data(),
+                               _handle->config->binary_results ? 1 : 0) ||
+          !detail::flush_nonblocking(_handle->postgres))
+      {
+        throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(_handle->postgres)));
+      }
+      ++_queued;
+    }
+
+    void pipeline_t::queue_direct(const std::string& stmt)
+    {
+      if (_handle->config->debug)
+      {
+        std::cerr << "PostgreSQL debug: queueing: " << stmt << std::endl;
+      }
+
+      if (!PQsendQueryParams(_handle->postgres, stmt.c_str(), 0, nullptr, nullptr, nullptr, nullptr,
+                             _handle->config->binary_results ? 1 : 0) ||
+          !detail::flush_nonblocking(_handle->postgres))
+      {
+        throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(_handle->postgres)));
+      }
+      ++_queued;
+    }
+
+    std::vector<pipeline_result_t> pipeline_t::sync()
+    {
+      if (!PQpipelineSync(_handle->postgres) || !detail::flush_nonblocking(_handle->postgres))
+      {
+        throw sqlpp::exception("PostgreSQL error: " + std::string(PQerrorMessage(_handle->postgres)));
+      }
+
+      std::vector<pipeline_result_t> results(_queued);
+      bool failed = false;
+      for (auto& entry : results)
+      {
+        PGresult* res = PQgetResult(_handle->postgres);
+        ExecStatusType ret = PQresultStatus(res);
+        switch (ret)
+        {
+          case PGRES_TUPLES_OK:
+          {
+            std::unique_ptr<detail::result_handle_t> rows(
+                new detail::result_handle_t(_handle->postgres, _handle->config->debug));
+            rows->result = res;
+            entry.affected_rows = static_cast<size_t>(PQntuples(res));
+            entry.result = bind_result_t{std::move(rows)};
+            res = nullptr;
+            break;
+          }
+          case PGRES_COMMAND_OK:
+            entry.affected_rows = std::strtoull(PQcmdTuples(res), nullptr, 10);
+            break;
+          case PGRES_PIPELINE_ABORTED:
+            entry.status = pipeline_result_t::status_t::aborted;
+            break;
+          default:
+            entry.status = pipeline_result_t::status_t::failed;
+            entry.error = "PostgreSQL error: " + std::string(PQresStatus(ret)) + std::string(": ") +
+                          std::string(PQresultErrorMessage(res));
+            failed = true;
+            break;
+        }
+        PQclear(res);
+
+        // Every statement's results are terminated by a null result
+        while ((res = PQgetResult(_handle->postgres)))
+        {
+          PQclear(res);
+        }
+      }
+      _queued = 0;
+
+      // Consume the sync point itself
+      PGresult* res = PQgetResult(_handle->postgres);
+      PQclear(res);
+
+      // A statement timeout set by the statements is undone with them. An aborted transaction is marked
+      // failed, so that it cannot be committed, which would roll it back silently.
+      if (failed)
+      {
+        _handle->session_timeout = -1;
+        _handle->transaction_failed = _handle->transaction_failed || _transaction_active;
+      }
+      if (failed && !_transaction_active)
+      {
+        for (auto& entry : results)
+        {
+          if (entry.status == pipeline_result_t::status_t::failed)
+          {
+            break;
+          }
+          entry.status = pipeline_result_t::status_t::rolled_back;
+        }
+      }
+      return results;
+    }
+#else
+    pipeline_t::pipeline_t(connection&, detail::connection_handle&, bool)
+    {
+      throw sqlpp::exception("PostgreSQL error: pipeline mode requires libpq 14 or newer");
+    }
+
+    pipeline_t::pipeline_t(pipeline_t&&)
+    {
+    }
+
+    pipeline_t::~pipeline_t()
+    {
+    }
+
+    void pipeline_t::queue_prepared(prepared_statement_t&)
+    {
+    }
+
+    void pipeline_t::queue_direct(const std::string&)
+    {
+    }
+
+    std::vector<pipeline_result_t> pipeline_t::sync()
+    {
+      return {};
+    }
+#endif
+  }
+}
@@ -26,17 +26,171 @@
  */
 
 #include <sqlpp11/postgresql/prepared_statement.h>
+#include <sqlpp11/postgresql/numeric_format.h>
 #include <sqlpp11/exception.h>
 
+#include "detail/binary_format.h"
 #include "detail/prepared_statement_handle.h"
 
+#include <cstdio>
+#include <cstring>
 #include <iostream>
-#include <sstream>
 
 namespace sqlpp
 {
   namespace postgresql
   {
+    namespace
+    {
+      void set_binary_parameter(detail::prepared_statement_handle_t& handle,
+                                size_t index,
+                                const char* data,
+                                size_t length)
+      {
+        std::memcpy(handle.param_storage(index, length, 1), data, length);
+      }
+
+      // Text parameters are passed to libpq without a length and need a terminator
+      void set_text_parameter(detail::prepared_statement_handle_t& handle,
+                              size_t index,
+                              const char* data,
+                              size_t length)
+      {
+        char* storage = handle.param_storage(index, length + 1, 0);
+        std::memcpy(storage, data, length);
+        storage[length] = '\0';
+      }
+
+      // Formats into a stack buffer instead of going through std::to_string.
+      template <typename... Args>
+      void set_formatted_parameter(detail::prepared_statement_handle_t& handle,
+                                   size_t index,
+                                   const char* format,
+                                   Args... args)
+      {
+        char data[328];
+        int length = std::snprintf(data, sizeof(data), format, args...);
+        set_text_parameter(handle, index, data, static_cast<size_t>(length));
+      }
+
+      bool is_valid(const std::vector<uint8_t>* validity, size_t i)
+      {
+        return !validity || (i / 8 < validity->size() && ((*validity)[i / 8] >> (i % 8)) & 1U);
+      }
+
+      void check_param_index(const detail::prepared_statement_handle_t& handle, size_t index)
+      {
+        if (index >= handle.param_count())
+        {
+          throw sqlpp::exception("PostgreSQL error: parameter index out of range");
+        }
+      }
+
+      // Binds a one dimensional array in the binary format: dimensions, null flag
+      // and element type, the bounds of the dimension, then every element as its
+      // length followed by its bytes, -1 for null. size(value) returns the length
+      // of an element and write(data, value) writes it.
+      template <typename T, typename Size, typename Write>
+      void set_binary_array(detail::prepared_statement_handle_t& handle,
+                            size_t index,
+                            Oid element,
+                            const std::vector<T>& values,
+                            const std::vector<uint8_t>* validity,
+                            Size size,
+                            Write write)
+      {
+        size_t length = values.empty() ? 12 : 20;
+        bool has_null = false;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+          const bool valid = is_valid(validity, i);
+          has_null = has_null || !valid;
+          length += 4 + (valid ? size(values[i]) : 0);
+        }
+
+        char* data = handle.param_storage(index, length, 1);
+        detail::write_uint32(data, values.empty() ? 0 : 1);
+        detail::write_uint32(data + 4, has_null ? 1 : 0);
+        detail::write_uint32(data + 8, element);
+        data += 12;
+        if (values.empty())
+        {
+          return;
+        }
+        detail::write_uint32(data, static_cast<uint32_t>(values.size()));
+        detail::write_uint32(data + 4, 1);  // lower bound
+        data += 8;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+          if (!is_valid(validity, i))
+          {
+            detail::write_uint32(data, static_cast<uint32_t>(-1));
+            data += 4;
+            continue;
+          }
+          const size_t element_size = size(values[i]);
+          detail::write_uint32(data, static_cast<uint32_t>(element_size));
+          write(data + 4, values[i]);
+          data += 4 + element_size;
+        }
+      }
+
+      // Binds an array as a literal like {1,NULL,3}, which the server parses
+      // according to the parameter's type. append(literal, value) appends an element.
+      template <typename T, typename Append>
+      void set_text_array(detail::prepared_statement_handle_t& handle,
+                          size_t index,
+                          const std::vector<T>& values,
+                          const std::vector<uint8_t>* validity,
+                          Append append)
+      {
+        std::string literal = "{";
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+          if (i > 0)
+          {
+            literal.push_back(',');
+          }
+          if (is_valid(validity, i))
+          {
+            append(literal, values[i]);
+          }
+          else
+          {
+            literal.append("NULL");
+          }
+        }
+        literal.push_back('}');
+        set_text_parameter(handle, index, literal.data(), literal.size());
+      }
+
+      template <typename... Args>
+      void append_formatted(std::string& literal, const char* format, Args... args)
+      {
+        char data[328];
+        int length = std::snprintf(data, sizeof(data), format, args...);
+        literal.append(data, static_cast<size_t>(length));
+      }
+
+      //! Enough digits to read back the same double
+      void append_double(std::string& literal, double value)
+      {
+        char data[32];
+        const int length = detail::format_double(data, sizeof(data), "%.17g", value);
+        literal.append(data, static_cast<size_t>(length));
+      }
+
+      template <size_t Size>
+      struct fixed_size_t
+      {
+        template <typename T>
+        size_t operator()(const T&) const
+        {
+          return Size;
+        }
+      };
+    }
+
     // ctor
     prepared_statement_t::prepared_statement_t(std::shared_ptr<detail::prepared_statement_handle_t>&& handle)
         : _handle{std::move(handle)}
@@ -48,6 +202,11 @@ namespace sqlpp
       }
     }
 
+    void prepared_statement_t::_reset()
+    {
+      _handle->reset_params();
+    }
+
     void prepared_statement_t::_bind_boolean_parameter(size_t index, const signed char* value, bool is_null)
     {
       if (_handle->debug)
@@ -56,16 +215,20 @@ namespace sqlpp
                   << " at index: " << index << ", being " << (is_null ? "" : "not ") << "null" << std::endl;
       }
 
-      _handle->nullValues[index] = is_null;
-      if (!is_null)
+      if (is_null)
+      {
+        _handle->set_param_null(index);
+      }
+      else
       {
-        if (*value)
+        if (_handle->param_type(index) == detail::oid::boolean)
         {
-          _handle->paramValues[index] = "TRUE";
+          const char data = *value ? 1 : 0;
+          set_binary_parameter(*_handle, index, &data, 1);
         }
         else
         {
-          _handle->paramValues[index] = "FALSE";
+          set_formatted_parameter(*_handle, index, "%s", *value ? "TRUE" : "FALSE");
         }
       }
     }
@@ -78,10 +241,31 @@ namespace sqlpp
                   << ", being " << (is_null ? "" : "not ") << "null" << std::endl;
       }
 
-      _handle->nullValues[index] = is_null;
-      if (!is_null)
+      if (is_null)
       {
-        _handle->paramValues[index] = std::to_string(*value);
+        _handle->set_param_null(index);
+      }
+      else
+      {
+        char data[8];
+        switch (_handle->param_type(index))
+        {
+          case detail::oid::float4:
+            detail::write_float4(data, static_cast<float>(*value));
+            set_binary_parameter(*_handle, index, data, 4);
+            break;
+          case detail::oid::float8:
+            detail::write_float8(data, *value);
+            set_binary_parameter(*_handle, index, data, 8);
+            break;
+          default:
+          {
+            char text[328];
+            const int length = detail::format_double(text, sizeof(text), "%f", *value);
+            set_text_parameter(*_handle, index, text, static_cast<size_t>(length));
+            break;
+          }
+        }
       }
     }
 
@@ -93,11 +277,38 @@ namespace sqlpp
                   << (is_null ? "" : "not ") << "null" << std::endl;
       }
 
-      // Assign values
-      _handle->nullValues[index] = is_null;
-      if (!is_null)
+      if (is_null)
       {
-        _handle->paramValues[index] = std::to_string(*value);
+        _handle->set_param_null(index);
+      }
+      else
+      {
+        // Out of range values are sent as text, the server rejects them like any other
+        const Oid type = _handle->param_type(index);
+        char data[8];
+        switch (detail::fits_integral_type(type, *value) ? type : 0)
+        {
+          case detail::oid::int2:
+            detail::write_uint16(data, static_cast<uint16_t>(*value));
+            set_binary_parameter(*_handle, index, data, 2);
+            break;
+          case detail::oid::int4:
+          case detail::oid::oid:
+            detail::write_uint32(data, static_cast<uint32_t>(*value));
+            set_binary_parameter(*_handle, index, data, 4);
+            break;
+          case detail::oid::int8:
+            detail::write_uint64(data, static_cast<uint64_t>(*value));
+            set_binary_parameter(*_handle, index, data, 8);
+            break;
+          case detail::oid::float8:
+            detail::write_float8(data, static_cast<double>(*value));
+            set_binary_parameter(*_handle, index, data, 8);
+            break;
+          default:
+            set_formatted_parameter(*_handle, index, "%lld", static_cast<long long>(*value));
+            break;
+        }
       }
     }
 
@@ -109,11 +320,168 @@ namespace sqlpp
                   << (is_null ? "" : "not ") << "null" << std::endl;
       }
 
-      // Assign values
-      _handle->nullValues[index] = is_null;
-      if (!is_null)
+      if (is_null)
+      {
+        _handle->set_param_null(index);
+      }
+      else
+      {
+        const Oid type = _handle->param_type(index);
+        if (detail::is_text_type(type))
+        {
+          // Sent with an explicit length, so the server does not need to look for a terminator
+          set_binary_parameter(*_handle, index, value->data(), value->size());
+        }
+        else if (type == detail::oid::jsonb)
+        {
+          // jsonb is prefixed with a one byte format version
+          char* storage = _handle->param_storage(index, value->size() + 1, 1);
+          storage[0] = 1;
+          std::memcpy(storage + 1, value->data(), value->size());
+        }
+        else
+        {
+          set_text_parameter(*_handle, index, value->data(), value->size());
+        }
+      }
+    }
+
+    void prepared_statement_t::bind_array(size_t index,
+                                          const std::vector<int64_t>& values,
+                                          const std::vector<uint8_t>* validity)
+    {
+      if (_handle->debug)
+      {
+        std::cerr << "PostgreSQL debug: binding integral array of " << values.size() << " values at index: " << index
+                  << std::endl;
+      }
+      check_param_index(*_handle, index);
+
+      Oid element = detail::array_element_type(_handle->param_type(index));
+      // An out of range element sends the array as a literal, the server rejects it like any other
+      for (size_t i = 0; element != 0 && i < values.size(); ++i)
+      {
+        if (is_valid(validity, i) && !detail::fits_integral_type(element, values[i]))
+        {
+          element = 0;
+        }
+      }
+      switch (element)
+      {
+        case detail::oid::int2:
+          set_binary_array(*_handle, index, element, values, validity, fixed_size_t<2>(),
+                           [](char* data, int64_t value) { detail::write_uint16(data, static_cast<uint16_t>(value)); });
+          break;
+        case detail::oid::int4:
+        case detail::oid::oid:
+          set_binary_array(*_handle, index, element, values, validity, fixed_size_t<4>(),
+                           [](char* data, int64_t value) { detail::write_uint32(data, static_cast<uint32_t>(value)); });
+          break;
+        case detail::oid::int8:
+          set_binary_array(*_handle, index, element, values, validity, fixed_size_t<8>(),
+                           [](char* data, int64_t value) { detail::write_uint64(data, static_cast<uint64_t>(value)); });
+          break;
+        case detail::oid::float8:
+          set_binary_array(*_handle, index, element, values, validity, fixed_size_t<8>(),
+                           [](char* data, int64_t value) { detail::write_float8(data, static_cast<double>(value)); });
+          break;
+        default:
+          set_text_array(*_handle, index, values, validity, [](std::string& literal, int64_t value) {
+            append_formatted(literal, "%lld", static_cast<long long>(value));
+          });
+          break;
+      }
+    }
+
+    void prepared_statement_t::bind_array(size_t index,
+                                          const std::vector<double>& values,
+                                          const std::vector<uint8_t>* validity)
+    {
+      if (_handle->debug)
+      {
+        std::cerr << "PostgreSQL debug: binding floating_point array of " << values.size()
+                  << " values at index: " << index << std::endl;
+      }
+      check_param_index(*_handle, index);
+
+      const Oid element = detail::array_element_type(_handle->param_type(index));
+      switch (element)
+      {
+        case detail::oid::float4:
+          set_binary_array(*_handle, index, element, values, validity, fixed_size_t<4>(),
+                           [](char* data, double value) { detail::write_float4(data, static_cast<float>(value)); });
+          break;
+        case detail::oid::float8:
+          set_binary_array(*_handle, index, element, values, validity, fixed_size_t<8>(),
+                           [](char* data, double value) { detail::write_float8(data, value); });
+          break;
+        default:
+          set_text_array(*_handle, index, values, validity, append_double);
+          break;
+      }
+    }
+
+    void prepared_statement_t::bind_array(size_t index,
+                                          const std::vector<signed char>& values,
+                                          const std::vector<uint8_t>* validity)
+    {
+      if (_handle->debug)
+      {
+        std::cerr << "PostgreSQL debug: binding boolean array of " << values.size() << " values at index: " << index
+                  << std::endl;
+      }
+      check_param_index(*_handle, index);
+
+      const Oid element = detail::array_element_type(_handle->param_type(index));
+      if (element == detail::oid::boolean)
+      {
+        set_binary_array(*_handle, index, element, values, validity, fixed_size_t<1>(),
+                         [](char* data, signed char value) { *data = value ? 1 : 0; });
+      }
+      else
+      {
+        set_text_array(*_handle, index, values, validity,
+                       [](std::string& literal, signed char value) { literal.push_back(value ? 't' : 'f'); });
+      }
+    }
+
+    void prepared_statement_t::bind_array(size_t index,
+                                          const std::vector<std::string>& values,
+                                          const std::vector<uint8_t>* validity)
+    {
+      if (_handle->debug)
+      {
+        std::cerr << "PostgreSQL debug: binding text array of " << values.size() << " values at index: " << index
+                  << std::endl;
+      }
+      check_param_index(*_handle, index);
+
+      const Oid element = detail::array_element_type(_handle->param_type(index));
+      switch (element)
       {
-        _handle->paramValues[index] = *value;
+        case detail::oid::text:
+        case detail::oid::varchar:
+        case detail::oid::bpchar:
+          // The binary representation of the character types is the text itself
+          set_binary_array(
+              *_handle, index, element, values, validity, [](const std::string& value) { return value.size(); },
+              [](char* data, const std::string& value) { std::memcpy(data, value.data(), value.size()); });
+          break;
+        default:
+          // Elements are quoted, so that commas, braces, blanks and the word NULL keep their meaning
+          set_text_array(*_handle, index, values, validity, [](std::string& literal, const std::string& value) {
+            literal.push_back('"');
+            for (const char c : value)
+            {
+              if (c == '"' || c == '\\')
+              {
+                literal.push_back('\\');
+              }
+              literal.push_back(c);
+            }
+            literal.push_back('"');
+          });
+          break;
       }
     }
   }
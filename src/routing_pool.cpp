@@ -0,0 +1,211 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <sqlpp11/postgresql/routing_pool.h>
+#include <sqlpp11/exception.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    namespace
+    {
+      // Zero while a replica has replayed all WAL it received: an idle primary
+      // writes none, and the age of the last replayed transaction keeps growing.
+      // That only holds while WAL is streaming from the primary though, a replica
+      // whose receiver is not streaming, or whose state cannot be read, yields
+      // NULL and counts as stale.
+      const char* const replay_lag_query =
+          "SELECT CASE WHEN NOT EXISTS (SELECT 1 FROM pg_stat_wal_receiver WHERE status = 'streaming') THEN NULL "
+          "WHEN pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0 "
+          "ELSE COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) * 1000, 0) END::bigint";
+    }
+
+    void routing_pool::routed_connection::release()
+    {
+      if (_connection)
+      {
+        _connection.release();
+        _pool->finished(_backend, std::chrono::steady_clock::now() - _since);
+      }
+    }
+
+    routing_pool::routing_pool(const routing_pool_config& config) : _config(config)
+    {
+      _backends.resize(1 + _config.replicas.size());
+      _backends[0].pool.reset(new connection_pool(_config.primary));
+      for (size_t i = 0; i < _config.replicas.size(); ++i)
+      {
+        _backends[i + 1].pool.reset(new connection_pool(_config.replicas[i]));
+      }
+    }
+
+    routing_pool::routed_connection routing_pool::write()
+    {
+      return checkout(0);
+    }
+
+    routing_pool::routed_connection routing_pool::checkout(size_t backend)
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_backends[backend].outstanding;
+      }
+      try
+      {
+        return routed_connection(*this, backend, _backends[backend].pool->get());
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_backends[backend].outstanding;
+        throw;
+      }
+    }
+
+    routing_pool::routed_connection routing_pool::read()
+    {
+      std::vector<bool> excluded(_backends.size(), false);
+      while (true)
+      {
+        size_t backend;
+        bool check_lag = false;
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          backend = pick_replica(excluded);
+          if (backend != 0)
+          {
+            // Claim the check, so that concurrent reads do not measure the same replica
+            const auto now = clock_t::now();
+            check_lag = now - _backends[backend].lag_checked >= _config.staleness_check_interval;
+            if (check_lag)
+            {
+              _backends[backend].lag_checked = now;
+            }
+          }
+        }
+        if (backend == 0 && !_config.primary_fallback)
+        {
+          throw sqlpp::exception("PostgreSQL error: no replica within the staleness limit");
+        }
+
+        routed_connection conn = checkout(backend);
+        if (!check_lag)
+        {
+          return conn;
+        }
+
+        std::chrono::milliseconds lag = std::chrono::milliseconds::max();
+        try
+        {
+          bind_result_t result = conn->select_impl(replay_lag_query);
+          std::vector<int64_t> values;
+          std::vector<uint8_t> validity;
+          result.fetch_columns({{0, values, &validity}});
+          if (!values.empty() && (validity.front() & 1U))
+          {
+            lag = std::chrono::milliseconds(values.front());
+          }
+        }
+        catch (const sqlpp::exception& e)
+        {
+          std::cerr << "PostgreSQL warning: cannot measure replica lag: " << e.what() << std::endl;
+        }
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _backends[backend].lag = lag;
+        }
+        if (lag <= _config.max_staleness)
+        {
+          return conn;
+        }
+        // Too stale, the connection goes back to its pool and another replica is tried
+        excluded[backend] = true;
+      }
+    }
+
+    size_t routing_pool::pick_replica(const std::vector<bool>& excluded)
+    {
+      const auto now = clock_t::now();
+      const size_t replicas = _backends.size() - 1;
+      size_t best = 0;
+      double best_score = std::numeric_limits<double>::max();
+      // Start at a rotating replica, so that ties are broken round robin
+      for (size_t n = 0; n < replicas; ++n)
+      {
+        const size_t i = 1 + (_next + n) % replicas;
+        const backend_t& replica = _backends[i];
+        // A stale replica is skipped until its lag is due to be measured again
+        if (excluded[i] ||
+            (replica.lag > _config.max_staleness && now - replica.lag_checked < _config.staleness_check_interval))
+        {
+          continue;
+        }
+
+        double score = static_cast<double>(replica.outstanding);
+        if (_config.balancing == routing_pool_config::balancing_t::latency_weighted)
+        {
+          score = (score + 1) * std::max(replica.latency, 1.0);
+        }
+        if (score < best_score)
+        {
+          best = i;
+          best_score = score;
+        }
+      }
+      ++_next;
+      return best;
+    }
+
+    void routing_pool::finished(size_t backend, clock_t::duration duration)
+    {
+      const auto micros =
+          static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+      std::lock_guard<std::mutex> lock(_mutex);
+      backend_t& b = _backends[backend];
+      --b.outstanding;
+      b.latency = b.latency == 0 ? micros : 0.8 * b.latency + 0.2 * micros;
+    }
+
+    std::chrono::milliseconds routing_pool::replica_lag(size_t replica) const
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _backends.at(replica + 1).lag;
+    }
+
+    size_t routing_pool::replica_outstanding(size_t replica) const
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _backends.at(replica + 1).outstanding;
+    }
+  }
+}
@@ -0,0 +1,104 @@
+/**
+ * Copyright © 2014-2015, Matthijs Möhlmann
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <sqlpp11/postgresql/savepoint.h>
+#include <sqlpp11/exception.h>
+
+#include "detail/connection_handle.h"
+
+namespace sqlpp
+{
+  namespace postgresql
+  {
+    savepoint_t::savepoint_t(connection& db, std::string name) : _db(&db), _name(std::move(name))
+    {
+      _db->savepoint(_name);
+      _finished = false;
+      _transaction = _db->_handle->transaction_counter;
+    }
+
+    savepoint_t::savepoint_t(savepoint_t&& other)
+        : _db(other._db), _name(std::move(other._name)), _finished(other._finished), _transaction(other._transaction)
+    {
+      other._finished = true;
+    }
+
+    savepoint_t::~savepoint_t()
+    {
+      // The savepoint is gone already if the enclosing transaction has ended, even if another one started
+      if (!_finished && in_transaction())
+      {
+        try
+        {
+          rollback();
+        }
+        catch (const std::exception& e)
+        {
+          _db->report_rollback_failure(std::string("savepoint destructor: ") + e.what());
+        }
+        catch (...)
+        {
+          _db->report_rollback_failure("savepoint destructor: unknown exception");
+        }
+      }
+    }
+
+    bool savepoint_t::in_transaction() const
+    {
+      return _db->is_transaction_active() && _db->_handle->transaction_counter == _transaction;
+    }
+
+    void savepoint_t::release()
+    {
+      if (_finished)
+      {
+        throw sqlpp::exception("PostgreSQL error: savepoint released or rolled back already");
+      }
+      if (!in_transaction())
+      {
+        throw sqlpp::exception("PostgreSQL error: the savepoint's transaction has ended");
+      }
+      _finished = true;
+      _db->release_savepoint(_name);
+    }
+
+    void savepoint_t::rollback()
+    {
+      if (_finished)
+      {
+        throw sqlpp::exception("PostgreSQL error: savepoint released or rolled back already");
+      }
+      if (!in_transaction())
+      {
+        throw sqlpp::exception("PostgreSQL error: the savepoint's transaction has ended");
+      }
+      _finished = true;
+      _db->rollback_to_savepoint(_name, true);
+    }
+  }
+}